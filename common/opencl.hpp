@@ -366,6 +366,13 @@ void clWriteAutorunKernelProfilingData(cl_device_id device, cl_program program)
     clCheckErrorMsg(status, "Failed to write Autorun Kernels profiling data");
 }
 
+cl_ulong clEventProfilingNS(cl_event event, cl_profiling_info info)
+{
+    cl_ulong time;
+    clGetEventProfilingInfo(event, info, sizeof(time), &time, NULL);
+    return time;
+}
+
 cl_ulong clTimeBetweenEventsNS(cl_event start, cl_event end)
 {
     cl_ulong timeStart;
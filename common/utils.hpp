@@ -1,6 +1,12 @@
 #pragma once
 #include <cstdint>
-#include <random>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <sys/time.h>
 
 inline uint64_t current_time_ns() __attribute__((always_inline));
@@ -11,20 +17,117 @@ inline uint64_t current_time_ns()
     return (t.tv_sec) * uint64_t(1000000000) + t.tv_nsec;
 }
 
-inline float next_float() __attribute__((always_inline));
-inline float next_float()
+// Runs f(begin, end) over [0, n) split in contiguous chunks, one per thread.
+// Small ranges are not worth the thread start-up and run on the caller.
+template <typename F>
+inline void parallel_for(size_t n, F f)
 {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dist(36.5, 37.5);
+    const size_t min_chunk = 1 << 16;
+    const size_t hw_threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t threads = std::min(hw_threads, (n + min_chunk - 1) / min_chunk);
 
-    return dist(gen);
+    if (threads <= 1) {
+        f(size_t(0), n);
+        return;
+    }
+
+    const size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(f, std::min(n, t * chunk), std::min(n, (t + 1) * chunk));
+    }
+    f(size_t(0), std::min(n, chunk));
+    for (auto & w : workers) w.join();
 }
 
-inline void random_fill(float * ptr, int n) __attribute__((always_inline));
-inline void random_fill(float * ptr, int n)
+// Blocks the threads that call wait() until `count` of them have, then lets
+// them all go. It can be crossed again by the same number of threads.
+struct Barrier
 {
-    for (int i = 0; i < n; ++i) {
-        ptr[i] = next_float();
+    std::mutex m;
+    std::condition_variable cv;
+    size_t count;
+    size_t waiting;
+    size_t generation;
+
+    explicit Barrier(size_t count)
+    : count(count)
+    , waiting(0)
+    , generation(0)
+    {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        const size_t current = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            ++generation;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&]() { return generation != current; });
+        }
     }
-}
\ No newline at end of file
+};
+
+// Counter-based generator: every item is a hash of (seed, index), so there is
+// no state carried between items and the loop vectorizes and splits freely.
+inline uint32_t hash32(uint32_t x) __attribute__((always_inline));
+inline uint32_t hash32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform float between 36.5 and 37.5 from the upper 24 bits of a hash
+inline float hash_float(uint32_t seed, uint32_t i) __attribute__((always_inline));
+inline float hash_float(uint32_t seed, uint32_t i)
+{
+    return 36.5f + (hash32(i * 0x9e3779b9U + seed) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Random item of type T: integers take the whole hash, floating point types
+// are uniform between 36.5 and 37.5
+template <typename T>
+inline T random_value(uint32_t seed, uint32_t i)
+{
+    return T(hash32(i * 0x9e3779b9U + seed));
+}
+
+template <>
+inline float random_value<float>(uint32_t seed, uint32_t i)
+{
+    return hash_float(seed, i);
+}
+
+template <>
+inline double random_value<double>(uint32_t seed, uint32_t i)
+{
+    return 36.5 + hash32(i * 0x9e3779b9U + seed) * (1.0 / 4294967296.0);
+}
+
+template <typename T>
+inline void random_fill(T * ptr, size_t n)
+{
+    // Every call draws a new dataset
+    static std::atomic<uint32_t> calls(0);
+    const uint32_t seed = hash32(calls++ ^ uint32_t(current_time_ns()));
+
+    parallel_for(n, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ptr[i] = random_value<T>(seed, i);
+        }
+    });
+}
+
+template <typename T>
+inline void parallel_copy(T * dst, const T * src, size_t n)
+{
+    parallel_for(n, [=](size_t begin, size_t end) {
+        std::memcpy(dst + begin, src + begin, (end - begin) * sizeof(T));
+    });
+}
@@ -3,16 +3,68 @@
 #define CHANNEL_DEPTH       32
 #define WORK_GROUP_SIZE_X   16
 
+// Widest vector variant to build (1, 2, 4, 8 or 16), override with -DVEC_MAX=W
+#ifndef VEC_MAX
+#define VEC_MAX             16
+#endif
+
+// Most compute units of the scalable autorun variants to build (1, 2, 4, 8 or
+// 16), override with -DAUTORUN_CU_MAX=U
+#ifndef AUTORUN_CU_MAX
+#define AUTORUN_CU_MAX      4
+#endif
+// Items moved at once by the scalable autorun variants, must match AUTORUN_VEC
+// in host/inc/common.hpp
+#define AUTORUN_VEC         4
+
+// Number of concurrent per-bank pipelines to build, override with -DN_BANKS=N
+#ifndef N_BANKS
+#define N_BANKS             2
+#endif
+
+// Extra multiply-adds val = val * FMA_ALPHA + FMA_BETA of the sequential compute
+// kernels, set at run time to raise their arithmetic intensity. The map
+// contracts towards 2, so that rounding differences do not grow.
+#define FMA_ALPHA           0.75f
+#define FMA_BETA            0.5f
+
+// Build the element type variants of the sequential kernels, left out by
+// default to keep the bitstream area of the headline kernels, enable with
+// -DTYPE_KERNELS=1
+#ifndef TYPE_KERNELS
+#define TYPE_KERNELS        0
+#endif
+#if TYPE_KERNELS
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+// Build the work-group size and SIMD variants of the NDRange kernel, left out
+// by default like the element types, enable with -DSIMD_KERNELS=1. Their
+// replicas on 2 or 4 compute units are built up to -DSIMD_CU_MAX=U.
+#ifndef SIMD_KERNELS
+#define SIMD_KERNELS        0
+#endif
+#ifndef SIMD_CU_MAX
+#define SIMD_CU_MAX         1
+#endif
+
+#define CAT_(a, b)          a##b
+#define CAT(a, b)           CAT_(a, b)
+#define VEC_TYPE(W)         CAT(DATA_TYPE, W)
+
 
 // Enqueue Task
 channel DATA_TYPE c_reader_compute_s __attribute__((depth(CHANNEL_DEPTH)));
 channel DATA_TYPE c_compute_writer_s __attribute__((depth(CHANNEL_DEPTH)));
 
+// Item counts n are ulong here and in all the kernels below, so that a batch
+// may exceed 2^31 items
 __attribute__((max_global_work_dim(0)))
 __kernel
-void reader_single(__global const DATA_TYPE * restrict data, const int n)
+void reader_single(__global const DATA_TYPE * restrict data, const ulong n)
 {
-    for (int i = 0; i < n; ++i) {
+    for (ulong i = 0; i < n; ++i) {
         const DATA_TYPE val = data[i];
         write_channel_intel(c_reader_compute_s, val);
     }
@@ -20,25 +72,108 @@ void reader_single(__global const DATA_TYPE * restrict data, const int n)
 
 __attribute__((max_global_work_dim(0)))
 __kernel
-void compute_single(const int n)
+void compute_single(const ulong n, const int fma)
 {
-    for (int i = 0; i < n; ++i) {
+    for (ulong i = 0; i < n; ++i) {
         DATA_TYPE val = read_channel_intel(c_reader_compute_s);
         val = val * val;
+        for (int k = 0; k < fma; ++k) val = val * FMA_ALPHA + FMA_BETA;
         write_channel_intel(c_compute_writer_s, val);
     }
 }
 
 __attribute__((max_global_work_dim(0)))
 __kernel
-void writer_single(__global DATA_TYPE * restrict data, const int n)
+void writer_single(__global DATA_TYPE * restrict data, const ulong n)
 {
-    for (int i = 0; i < n; ++i) {
+    for (ulong i = 0; i < n; ++i) {
         const DATA_TYPE val = read_channel_intel(c_compute_writer_s);
         data[i] = val;
     }
 }
 
+// Launch latency: a near-empty task, which stores n only when asked to
+__attribute__((max_global_work_dim(0)))
+__kernel
+void launch_single(__global DATA_TYPE * restrict data, const int n)
+{
+    if (n > 0) data[0] = n;
+}
+
+// Persistent streaming: the kernels are launched once and stream a ring of
+// `slots` chunks of `chunk` items that the host fills in shared memory. The
+// host publishes the chunk with sequence number seq by storing seq in
+// doorbell[seq % slots], or STREAM_STOP to stop the kernels, and the writer
+// stores seq in done[seq % slots] once the chunk has been written back.
+#define STREAM_STOP         -2
+
+channel int c_reader_compute_pc __attribute__((depth(CHANNEL_DEPTH)));
+channel int c_compute_writer_pc __attribute__((depth(CHANNEL_DEPTH)));
+channel DATA_TYPE c_reader_compute_p __attribute__((depth(CHANNEL_DEPTH)));
+channel DATA_TYPE c_compute_writer_p __attribute__((depth(CHANNEL_DEPTH)));
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void reader_persistent(__global volatile const DATA_TYPE * restrict data,
+                       __global volatile const int * restrict doorbell,
+                       const int chunk,
+                       const int slots)
+{
+    for (int seq = 0; ; ++seq) {
+        const int s = seq % slots;
+        int bell;
+        do {
+            bell = doorbell[s];
+        } while (bell != seq && bell != STREAM_STOP);
+
+        write_channel_intel(c_reader_compute_pc, bell);
+        if (bell == STREAM_STOP) break;
+
+        for (int i = 0; i < chunk; ++i) {
+            const DATA_TYPE val = data[s * chunk + i];
+            write_channel_intel(c_reader_compute_p, val);
+        }
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void compute_persistent(const int chunk)
+{
+    while (1) {
+        const int seq = read_channel_intel(c_reader_compute_pc);
+        write_channel_intel(c_compute_writer_pc, seq);
+        if (seq == STREAM_STOP) break;
+
+        for (int i = 0; i < chunk; ++i) {
+            DATA_TYPE val = read_channel_intel(c_reader_compute_p);
+            val = val * val;
+            write_channel_intel(c_compute_writer_p, val);
+        }
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void writer_persistent(__global volatile DATA_TYPE * restrict data,
+                       __global volatile int * restrict done,
+                       const int chunk,
+                       const int slots)
+{
+    while (1) {
+        const int seq = read_channel_intel(c_compute_writer_pc);
+        if (seq == STREAM_STOP) break;
+
+        const int s = seq % slots;
+        for (int i = 0; i < chunk; ++i) {
+            const DATA_TYPE val = read_channel_intel(c_compute_writer_p);
+            data[s * chunk + i] = val;
+        }
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        done[s] = seq;
+    }
+}
+
 // NDRange
 channel DATA_TYPE c_reader_compute_r __attribute__((depth(CHANNEL_DEPTH)));
 channel DATA_TYPE c_compute_writer_r __attribute__((depth(CHANNEL_DEPTH)));
@@ -46,9 +181,9 @@ channel DATA_TYPE c_compute_writer_r __attribute__((depth(CHANNEL_DEPTH)));
 __attribute__((uses_global_work_offset(0)))
 __attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))
 __kernel
-void reader_range(__global const DATA_TYPE * restrict data, const int n)
+void reader_range(__global const DATA_TYPE * restrict data, const ulong n)
 {
-    const int gid = get_global_id(0);
+    const size_t gid = get_global_id(0);
 
     const DATA_TYPE val = data[gid];
     write_channel_intel(c_reader_compute_r, val);
@@ -57,21 +192,22 @@ void reader_range(__global const DATA_TYPE * restrict data, const int n)
 __attribute__((uses_global_work_offset(0)))
 __attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))
 __kernel
-void compute_range(const int n)
+void compute_range(const ulong n, const int fma)
 {
-    const int gid = get_global_id(0);
+    const size_t gid = get_global_id(0);
 
     DATA_TYPE val = read_channel_intel(c_reader_compute_r);
     val = val * val;
+    for (int k = 0; k < fma; ++k) val = val * FMA_ALPHA + FMA_BETA;
     write_channel_intel(c_compute_writer_r, val);
 }
 
 __attribute__((uses_global_work_offset(0)))
 __attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))
 __kernel
-void writer_range(__global DATA_TYPE * restrict data, const int n)
+void writer_range(__global DATA_TYPE * restrict data, const ulong n)
 {
-    const int gid = get_global_id(0);
+    const size_t gid = get_global_id(0);
 
     const DATA_TYPE val = read_channel_intel(c_compute_writer_r);
     data[gid] = val;
@@ -84,9 +220,9 @@ channel DATA_TYPE c_compute_writer_a[N_COMPUTE_UNITS] __attribute__((depth(CHANN
 
 __attribute__((max_global_work_dim(0)))
 __kernel
-void reader_autorun(__global const DATA_TYPE * restrict data, const int n)
+void reader_autorun(__global const DATA_TYPE * restrict data, const ulong n)
 {
-    for (int i = 0; i < n; ++i) {
+    for (ulong i = 0; i < n; ++i) {
         const DATA_TYPE val = data[i];
         write_channel_intel(c_reader_compute_a[i % N_COMPUTE_UNITS], val);
     }
@@ -109,10 +245,423 @@ void compute_autorun()
 
 __attribute__((max_global_work_dim(0)))
 __kernel
-void writer_autorun(__global DATA_TYPE * restrict data, const int n)
+void writer_autorun(__global DATA_TYPE * restrict data, const ulong n)
 {
-    for (int i = 0; i < n; ++i) {
+    for (ulong i = 0; i < n; ++i) {
         const DATA_TYPE val = read_channel_intel(c_compute_writer_a[i % N_COMPUTE_UNITS]);
         data[i] = val;
     }
 }
+
+// Scalable autorun: U compute units, each fed whole vectors of AUTORUN_VEC
+// items in turn, so that every channel moves a block of items at once and the
+// number of units is a build option (reader_autorun_cu8, ...)
+#define DEFINE_AUTORUN_KERNELS(U)                                                              \
+channel VEC_TYPE(AUTORUN_VEC) c_reader_compute_cu##U[U] __attribute__((depth(CHANNEL_DEPTH))); \
+channel VEC_TYPE(AUTORUN_VEC) c_compute_writer_cu##U[U] __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                                               \
+__attribute__((max_global_work_dim(0)))                                                        \
+__kernel                                                                                       \
+void reader_autorun_cu##U(__global const VEC_TYPE(AUTORUN_VEC) * restrict data, const ulong n) \
+{                                                                                              \
+    for (ulong i = 0; i < n; ++i) {                                                            \
+        const VEC_TYPE(AUTORUN_VEC) val = data[i];                                             \
+        write_channel_intel(c_reader_compute_cu##U[i % U], val);                               \
+    }                                                                                          \
+}                                                                                              \
+                                                                                               \
+__attribute__((max_global_work_dim(0)))                                                        \
+__attribute__((autorun))                                                                       \
+__attribute__((num_compute_units(U)))                                                          \
+__kernel                                                                                       \
+void compute_autorun_cu##U()                                                                   \
+{                                                                                              \
+    const int cid = get_compute_id(0);                                                         \
+                                                                                               \
+    while (1) {                                                                                \
+        VEC_TYPE(AUTORUN_VEC) val = read_channel_intel(c_reader_compute_cu##U[cid]);           \
+        val = val * val;                                                                       \
+        write_channel_intel(c_compute_writer_cu##U[cid], val);                                 \
+    }                                                                                          \
+}                                                                                              \
+                                                                                               \
+__attribute__((max_global_work_dim(0)))                                                        \
+__kernel                                                                                       \
+void writer_autorun_cu##U(__global VEC_TYPE(AUTORUN_VEC) * restrict data, const ulong n)       \
+{                                                                                              \
+    for (ulong i = 0; i < n; ++i) {                                                            \
+        const VEC_TYPE(AUTORUN_VEC) val = read_channel_intel(c_compute_writer_cu##U[i % U]);   \
+        data[i] = val;                                                                         \
+    }                                                                                          \
+}
+
+#if AUTORUN_CU_MAX >= 1
+DEFINE_AUTORUN_KERNELS(1)
+#endif
+#if AUTORUN_CU_MAX >= 2
+DEFINE_AUTORUN_KERNELS(2)
+#endif
+#if AUTORUN_CU_MAX >= 4
+DEFINE_AUTORUN_KERNELS(4)
+#endif
+#if AUTORUN_CU_MAX >= 8
+DEFINE_AUTORUN_KERNELS(8)
+#endif
+#if AUTORUN_CU_MAX >= 16
+DEFINE_AUTORUN_KERNELS(16)
+#endif
+
+// Access patterns: every item is still read and written exactly once, only in
+// a different order, so that results are checked as for the other kernels
+channel DATA_TYPE c_reader_compute_b __attribute__((depth(CHANNEL_DEPTH)));
+channel DATA_TYPE c_compute_writer_b __attribute__((depth(CHANNEL_DEPTH)));
+
+// Visits blocks of `block` consecutive items, jumping `stride` blocks ahead
+// after each one and wrapping around to the first block not visited yet.
+// A block of 1 item is a plain strided access.
+__attribute__((max_global_work_dim(0)))
+__kernel
+void reader_blocked(__global const DATA_TYPE * restrict data, const ulong n,
+                    const int stride, const int block)
+{
+    const ulong n_blocks = n / block;
+    ulong first = 0;
+    ulong b = 0;
+    int e = 0;
+    for (ulong i = 0; i < n; ++i) {
+        const DATA_TYPE val = data[b * block + e];
+        write_channel_intel(c_reader_compute_b, val);
+
+        if (++e == block) {
+            e = 0;
+            b += stride;
+            if (b >= n_blocks) b = ++first;
+        }
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void compute_blocked(const ulong n)
+{
+    for (ulong i = 0; i < n; ++i) {
+        DATA_TYPE val = read_channel_intel(c_reader_compute_b);
+        val = val * val;
+        write_channel_intel(c_compute_writer_b, val);
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void writer_blocked(__global DATA_TYPE * restrict data, const ulong n,
+                    const int stride, const int block)
+{
+    const ulong n_blocks = n / block;
+    ulong first = 0;
+    ulong b = 0;
+    int e = 0;
+    for (ulong i = 0; i < n; ++i) {
+        const DATA_TYPE val = read_channel_intel(c_compute_writer_b);
+        data[b * block + e] = val;
+
+        if (++e == block) {
+            e = 0;
+            b += stride;
+            if (b >= n_blocks) b = ++first;
+        }
+    }
+}
+
+// Gather / Scatter through an index buffer holding a permutation of [0, n)
+channel DATA_TYPE c_reader_compute_g __attribute__((depth(CHANNEL_DEPTH)));
+channel DATA_TYPE c_compute_writer_g __attribute__((depth(CHANNEL_DEPTH)));
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void reader_gather(__global const DATA_TYPE * restrict data,
+                   __global const int * restrict index, const ulong n)
+{
+    for (ulong i = 0; i < n; ++i) {
+        const DATA_TYPE val = data[index[i]];
+        write_channel_intel(c_reader_compute_g, val);
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void compute_gather(const ulong n)
+{
+    for (ulong i = 0; i < n; ++i) {
+        DATA_TYPE val = read_channel_intel(c_reader_compute_g);
+        val = val * val;
+        write_channel_intel(c_compute_writer_g, val);
+    }
+}
+
+__attribute__((max_global_work_dim(0)))
+__kernel
+void writer_scatter(__global DATA_TYPE * restrict data,
+                    __global const int * restrict index, const ulong n)
+{
+    for (ulong i = 0; i < n; ++i) {
+        const DATA_TYPE val = read_channel_intel(c_compute_writer_g);
+        data[index[i]] = val;
+    }
+}
+
+// Vector variants: each loop iteration / work-item moves W elements at once
+#define DEFINE_VEC_KERNELS(W)                                                      \
+channel VEC_TYPE(W) c_reader_compute_s_v##W __attribute__((depth(CHANNEL_DEPTH))); \
+channel VEC_TYPE(W) c_compute_writer_s_v##W __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                                   \
+__attribute__((max_global_work_dim(0)))                                            \
+__kernel                                                                           \
+void reader_single_v##W(__global const VEC_TYPE(W) * restrict data, const ulong n) \
+{                                                                                  \
+    for (ulong i = 0; i < n; ++i) {                                                \
+        const VEC_TYPE(W) val = data[i];                                           \
+        write_channel_intel(c_reader_compute_s_v##W, val);                         \
+    }                                                                              \
+}                                                                                  \
+                                                                                   \
+__attribute__((max_global_work_dim(0)))                                            \
+__kernel                                                                           \
+void compute_single_v##W(const ulong n, const int fma)                             \
+{                                                                                  \
+    for (ulong i = 0; i < n; ++i) {                                                \
+        VEC_TYPE(W) val = read_channel_intel(c_reader_compute_s_v##W);             \
+        val = val * val;                                                           \
+        for (int k = 0; k < fma; ++k) val = val * FMA_ALPHA + FMA_BETA;            \
+        write_channel_intel(c_compute_writer_s_v##W, val);                         \
+    }                                                                              \
+}                                                                                  \
+                                                                                   \
+__attribute__((max_global_work_dim(0)))                                            \
+__kernel                                                                           \
+void writer_single_v##W(__global VEC_TYPE(W) * restrict data, const ulong n)       \
+{                                                                                  \
+    for (ulong i = 0; i < n; ++i) {                                                \
+        const VEC_TYPE(W) val = read_channel_intel(c_compute_writer_s_v##W);       \
+        data[i] = val;                                                             \
+    }                                                                              \
+}                                                                                  \
+                                                                                   \
+channel VEC_TYPE(W) c_reader_compute_r_v##W __attribute__((depth(CHANNEL_DEPTH))); \
+channel VEC_TYPE(W) c_compute_writer_r_v##W __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                                   \
+__attribute__((uses_global_work_offset(0)))                                        \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))                       \
+__kernel                                                                           \
+void reader_range_v##W(__global const VEC_TYPE(W) * restrict data, const ulong n)  \
+{                                                                                  \
+    const size_t gid = get_global_id(0);                                           \
+                                                                                   \
+    const VEC_TYPE(W) val = data[gid];                                             \
+    write_channel_intel(c_reader_compute_r_v##W, val);                             \
+}                                                                                  \
+                                                                                   \
+__attribute__((uses_global_work_offset(0)))                                        \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))                       \
+__kernel                                                                           \
+void compute_range_v##W(const ulong n, const int fma)                              \
+{                                                                                  \
+    VEC_TYPE(W) val = read_channel_intel(c_reader_compute_r_v##W);                 \
+    val = val * val;                                                               \
+    for (int k = 0; k < fma; ++k) val = val * FMA_ALPHA + FMA_BETA;                \
+    write_channel_intel(c_compute_writer_r_v##W, val);                             \
+}                                                                                  \
+                                                                                   \
+__attribute__((uses_global_work_offset(0)))                                        \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))                       \
+__kernel                                                                           \
+void writer_range_v##W(__global VEC_TYPE(W) * restrict data, const ulong n)        \
+{                                                                                  \
+    const size_t gid = get_global_id(0);                                           \
+                                                                                   \
+    const VEC_TYPE(W) val = read_channel_intel(c_compute_writer_r_v##W);           \
+    data[gid] = val;                                                               \
+}
+
+#if VEC_MAX >= 2
+DEFINE_VEC_KERNELS(2)
+#endif
+#if VEC_MAX >= 4
+DEFINE_VEC_KERNELS(4)
+#endif
+#if VEC_MAX >= 8
+DEFINE_VEC_KERNELS(8)
+#endif
+#if VEC_MAX >= 16
+DEFINE_VEC_KERNELS(16)
+#endif
+
+// Per-bank pipelines: one reader/compute/writer pipeline for each memory bank,
+// run concurrently on buffers that the host places in that bank
+#define DEFINE_BANK_KERNELS(B)                                                 \
+channel DATA_TYPE c_reader_compute_k##B __attribute__((depth(CHANNEL_DEPTH))); \
+channel DATA_TYPE c_compute_writer_k##B __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                               \
+__attribute__((max_global_work_dim(0)))                                        \
+__kernel                                                                       \
+void reader_bank##B(__global const DATA_TYPE * restrict data, const ulong n)   \
+{                                                                              \
+    for (ulong i = 0; i < n; ++i) {                                            \
+        const DATA_TYPE val = data[i];                                         \
+        write_channel_intel(c_reader_compute_k##B, val);                       \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+__attribute__((max_global_work_dim(0)))                                        \
+__kernel                                                                       \
+void compute_bank##B(const ulong n)                                            \
+{                                                                              \
+    for (ulong i = 0; i < n; ++i) {                                            \
+        DATA_TYPE val = read_channel_intel(c_reader_compute_k##B);             \
+        val = val * val;                                                       \
+        write_channel_intel(c_compute_writer_k##B, val);                       \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+__attribute__((max_global_work_dim(0)))                                        \
+__kernel                                                                       \
+void writer_bank##B(__global DATA_TYPE * restrict data, const ulong n)         \
+{                                                                              \
+    for (ulong i = 0; i < n; ++i) {                                            \
+        const DATA_TYPE val = read_channel_intel(c_compute_writer_k##B);       \
+        data[i] = val;                                                         \
+    }                                                                          \
+}
+
+#if N_BANKS >= 1
+DEFINE_BANK_KERNELS(0)
+#endif
+#if N_BANKS >= 2
+DEFINE_BANK_KERNELS(1)
+#endif
+#if N_BANKS >= 3
+DEFINE_BANK_KERNELS(2)
+#endif
+#if N_BANKS >= 4
+DEFINE_BANK_KERNELS(3)
+#endif
+
+// Element type variants of the sequential Task and NDRange pipelines, named
+// after the OpenCL type (reader_single_short, compute_range_half, ...)
+#define DEFINE_TYPE_KERNELS(T)                                          \
+channel T c_reader_compute_s_##T __attribute__((depth(CHANNEL_DEPTH))); \
+channel T c_compute_writer_s_##T __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                        \
+__attribute__((max_global_work_dim(0)))                                 \
+__kernel                                                                \
+void reader_single_##T(__global const T * restrict data, const ulong n) \
+{                                                                       \
+    for (ulong i = 0; i < n; ++i) {                                     \
+        const T val = data[i];                                          \
+        write_channel_intel(c_reader_compute_s_##T, val);               \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+__attribute__((max_global_work_dim(0)))                                 \
+__kernel                                                                \
+void compute_single_##T(const ulong n)                                  \
+{                                                                       \
+    for (ulong i = 0; i < n; ++i) {                                     \
+        T val = read_channel_intel(c_reader_compute_s_##T);             \
+        val = val * val;                                                \
+        write_channel_intel(c_compute_writer_s_##T, val);               \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+__attribute__((max_global_work_dim(0)))                                 \
+__kernel                                                                \
+void writer_single_##T(__global T * restrict data, const ulong n)       \
+{                                                                       \
+    for (ulong i = 0; i < n; ++i) {                                     \
+        const T val = read_channel_intel(c_compute_writer_s_##T);       \
+        data[i] = val;                                                  \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+channel T c_reader_compute_r_##T __attribute__((depth(CHANNEL_DEPTH))); \
+channel T c_compute_writer_r_##T __attribute__((depth(CHANNEL_DEPTH))); \
+                                                                        \
+__attribute__((uses_global_work_offset(0)))                             \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))            \
+__kernel                                                                \
+void reader_range_##T(__global const T * restrict data, const ulong n)  \
+{                                                                       \
+    const size_t gid = get_global_id(0);                                \
+                                                                        \
+    const T val = data[gid];                                            \
+    write_channel_intel(c_reader_compute_r_##T, val);                   \
+}                                                                       \
+                                                                        \
+__attribute__((uses_global_work_offset(0)))                             \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))            \
+__kernel                                                                \
+void compute_range_##T(const ulong n)                                   \
+{                                                                       \
+    T val = read_channel_intel(c_reader_compute_r_##T);                 \
+    val = val * val;                                                    \
+    write_channel_intel(c_compute_writer_r_##T, val);                   \
+}                                                                       \
+                                                                        \
+__attribute__((uses_global_work_offset(0)))                             \
+__attribute__((reqd_work_group_size(WORK_GROUP_SIZE_X,1,1)))            \
+__kernel                                                                \
+void writer_range_##T(__global T * restrict data, const ulong n)        \
+{                                                                       \
+    const size_t gid = get_global_id(0);                                \
+                                                                        \
+    const T val = read_channel_intel(c_compute_writer_r_##T);           \
+    data[gid] = val;                                                    \
+}
+
+#if TYPE_KERNELS
+DEFINE_TYPE_KERNELS(char)
+DEFINE_TYPE_KERNELS(short)
+DEFINE_TYPE_KERNELS(int)
+DEFINE_TYPE_KERNELS(half)
+DEFINE_TYPE_KERNELS(double)
+#endif
+
+// Work-group size, SIMD and compute unit variants of the NDRange path, named
+// after the three (range_fused_wg64_simd4_cu1, ...). num_simd_work_items cannot
+// vectorize channel accesses, so reader, compute and writer are fused into one
+// kernel.
+#define DEFINE_SIMD_KERNELS(WG, SIMD, CU)                                              \
+__attribute__((uses_global_work_offset(0)))                                            \
+__attribute__((reqd_work_group_size(WG,1,1)))                                          \
+__attribute__((num_simd_work_items(SIMD)))                                             \
+__attribute__((num_compute_units(CU)))                                                 \
+__kernel                                                                               \
+void range_fused_wg##WG##_simd##SIMD##_cu##CU(__global const DATA_TYPE * restrict src, \
+                                              __global DATA_TYPE * restrict dst,       \
+                                              const ulong n)                           \
+{                                                                                      \
+    const size_t gid = get_global_id(0);                                               \
+                                                                                       \
+    const DATA_TYPE val = src[gid];                                                    \
+    dst[gid] = val * val;                                                              \
+}
+
+#define DEFINE_SIMD_KERNELS_CU(CU) \
+DEFINE_SIMD_KERNELS(16, 1, CU)     \
+DEFINE_SIMD_KERNELS(16, 4, CU)     \
+DEFINE_SIMD_KERNELS(16, 16, CU)    \
+DEFINE_SIMD_KERNELS(64, 1, CU)     \
+DEFINE_SIMD_KERNELS(64, 4, CU)     \
+DEFINE_SIMD_KERNELS(64, 16, CU)    \
+DEFINE_SIMD_KERNELS(256, 1, CU)    \
+DEFINE_SIMD_KERNELS(256, 4, CU)    \
+DEFINE_SIMD_KERNELS(256, 16, CU)
+
+#if SIMD_KERNELS
+DEFINE_SIMD_KERNELS_CU(1)
+#if SIMD_CU_MAX >= 2
+DEFINE_SIMD_KERNELS_CU(2)
+#endif
+#if SIMD_CU_MAX >= 4
+DEFINE_SIMD_KERNELS_CU(4)
+#endif
+#endif
@@ -1,7 +1,27 @@
 #pragma once
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
 #include "opencl.hpp"
 
 #define AOCL_ALIGNMENT  64
+#define HUGE_PAGE_SIZE  (2 << 20)
+
+// Intel FPGA manual memory partitioning: bank 0 lets the runtime interleave
+// the buffer across banks, banks 1-7 pin it to CL_CHANNEL_n_INTELFPGA. The
+// kernels must be compiled with -no-interleaving=default.
+cl_mem_flags clBankFlags(int bank)
+{
+    const cl_mem_flags channels[] = {0,
+                                     CL_CHANNEL_1_INTELFPGA, CL_CHANNEL_2_INTELFPGA,
+                                     CL_CHANNEL_3_INTELFPGA, CL_CHANNEL_4_INTELFPGA,
+                                     CL_CHANNEL_5_INTELFPGA, CL_CHANNEL_6_INTELFPGA,
+                                     CL_CHANNEL_7_INTELFPGA};
+    if (bank < 0 or bank > 7) clCheckErrorMsg(CL_INVALID_VALUE, "Invalid memory bank");
+    return channels[bank];
+}
 
 template <typename T>
 struct clMemory
@@ -25,10 +45,26 @@ struct clMemory
     {}
 
     virtual void map(cl_map_flags flags, cl_event * event = NULL, bool blocking = true) = 0;
-    virtual void read(cl_event * event = NULL, bool blocking = true) = 0;
-    virtual void write(cl_event * event = NULL, bool blocking = true) = 0;
+    virtual void read(cl_event * event = NULL, bool blocking = true,
+                      cl_uint num_wait = 0, const cl_event * wait_list = NULL) = 0;
+    virtual void write(cl_event * event = NULL, bool blocking = true,
+                       cl_uint num_wait = 0, const cl_event * wait_list = NULL) = 0;
     virtual void release() = 0;
 
+    // Hands the host pointer to the host before it is filled, and back to the
+    // device before a kernel writes the buffer. Only memory types whose host
+    // pointer cannot be accessed at any time need to do something.
+    virtual void host_acquire(cl_map_flags)
+    {}
+
+    virtual void host_release()
+    {}
+
+    virtual void set_kernel_arg(cl_kernel kernel, cl_uint index)
+    {
+        clCheckError(clSetKernelArg(kernel, index, sizeof(buffer), &buffer));
+    }
+
     virtual ~clMemory() {};
 };
 
@@ -68,10 +104,12 @@ struct clMemShared: clMemory<T>
         clCheckErrorMsg(status, "Failed to map clBufferShared");
     }
 
-    void read(cl_event * event = NULL, bool blocking = true) override
+    void read(cl_event * event = NULL, bool blocking = true,
+              cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
     {}
 
-    void write(cl_event * event = NULL, bool blocking = true) override
+    void write(cl_event * event = NULL, bool blocking = true,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
     {}
 
     void release() override
@@ -95,12 +133,19 @@ struct clMemBuffer : clMemory<T>
     clMemBuffer(cl_context context,
                 cl_command_queue queue,
                 size_t size,
-                cl_mem_flags buffer_flags)
+                cl_mem_flags buffer_flags,
+                cl_mem device_buffer = NULL)
     : clMemory<T>(context, queue, size, buffer_flags)
     {
+        // An already allocated device buffer (e.g. a sub-buffer) is adopted
+        // and released with this object
         cl_int status;
-        buffer = clCreateBuffer(context, buffer_flags, size * sizeof(T), NULL, &status);
-        clCheckErrorMsg(status, "Failed to create clBuffer");
+        if (device_buffer) {
+            buffer = device_buffer;
+        } else {
+            buffer = clCreateBuffer(context, buffer_flags, size * sizeof(T), NULL, &status);
+            clCheckErrorMsg(status, "Failed to create clBuffer");
+        }
 
         status = posix_memalign((void**)&ptr, AOCL_ALIGNMENT, size * sizeof(T));
         if (status != 0) clCheckErrorMsg(-255, "Failed to create host buffer");
@@ -109,18 +154,20 @@ struct clMemBuffer : clMemory<T>
     void map(cl_map_flags flags, cl_event * event = NULL, bool blocking = true) override
     {}
 
-    void read(cl_event * event = NULL, bool blocking = true) override
+    void read(cl_event * event = NULL, bool blocking = true,
+              cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
     {
         clCheckError(clEnqueueReadBuffer(queue, buffer, blocking,
                                          0, size * sizeof(T), ptr,
-                                         0, NULL, event));
+                                         num_wait, wait_list, event));
     }
 
-    void write(cl_event * event = NULL, bool blocking = true) override
+    void write(cl_event * event = NULL, bool blocking = true,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
     {
         clCheckError(clEnqueueWriteBuffer(queue, buffer, blocking,
                                           0, size * sizeof(T), ptr,
-                                          0, NULL, event));
+                                          num_wait, wait_list, event));
     }
 
     void release() override
@@ -129,3 +176,288 @@ struct clMemBuffer : clMemory<T>
         if (ptr) free(ptr);
     }
 };
+
+template <typename T>
+struct clMemSVM : clMemory<T>
+{
+    using super = clMemory<T>;
+    using super::context;
+    using super::queue;
+    using super::size;
+    using super::buffer_flags;
+    using super::buffer;
+    using super::ptr;
+
+    // Fine-grained buffers are coherent: host and device access them at any
+    // time. Coarse-grained ones must be mapped for the host and unmapped for
+    // the device, which is what write() and read() do.
+    bool fine_grain;
+    bool mapped;
+
+    clMemSVM(cl_context context,
+             cl_command_queue queue,
+             size_t size,
+             cl_mem_flags buffer_flags,
+             bool fine_grain)
+    : super(context, queue, size, buffer_flags)
+    , fine_grain(fine_grain)
+    , mapped(false)
+    {
+        cl_svm_mem_flags svm_flags = buffer_flags;
+        if (fine_grain) svm_flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+
+        buffer = NULL;
+        ptr = (T *)clSVMAlloc(context, svm_flags, size * sizeof(T), AOCL_ALIGNMENT);
+        if (ptr == NULL) clCheckErrorMsg(CL_MEM_OBJECT_ALLOCATION_FAILURE, "Failed to create clSVM");
+    }
+
+    void map(cl_map_flags flags,
+             cl_event * event = NULL,
+             bool blocking = true) override
+    {
+        if (fine_grain or mapped) return;
+        clCheckErrorMsg(clEnqueueSVMMap(queue, blocking, flags,
+                                        ptr, size * sizeof(T),
+                                        0, NULL, event),
+                        "Failed to map clSVM");
+        mapped = true;
+    }
+
+    void unmap(cl_event * event = NULL,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL)
+    {
+        clCheckErrorMsg(clEnqueueSVMUnmap(queue, ptr, num_wait, wait_list, event),
+                        "Failed to unmap clSVM");
+        mapped = false;
+    }
+
+    // Fine-grained buffers need no command: a marker still provides the event
+    void marker(cl_event * event, cl_uint num_wait, const cl_event * wait_list)
+    {
+        if (event) clCheckError(clEnqueueMarkerWithWaitList(queue, num_wait, wait_list, event));
+    }
+
+    // Host writes are published to the device
+    void write(cl_event * event = NULL, bool blocking = true,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        if (fine_grain or !mapped) {
+            marker(event, num_wait, wait_list);
+        } else {
+            unmap(event, num_wait, wait_list);
+        }
+        if (blocking and event) clCheckError(clWaitForEvents(1, event));
+    }
+
+    // Device writes are made visible to the host
+    void read(cl_event * event = NULL, bool blocking = true,
+              cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        if (fine_grain or mapped) {
+            marker(event, num_wait, wait_list);
+        } else {
+            clCheckErrorMsg(clEnqueueSVMMap(queue, blocking, CL_MAP_READ,
+                                            ptr, size * sizeof(T),
+                                            num_wait, wait_list, event),
+                            "Failed to map clSVM");
+            mapped = true;
+        }
+        if (blocking and event) clCheckError(clWaitForEvents(1, event));
+    }
+
+    void host_acquire(cl_map_flags flags) override
+    {
+        map(flags);
+    }
+
+    void host_release() override
+    {
+        if (fine_grain or !mapped) return;
+        cl_event event;
+        unmap(&event);
+        clCheckError(clWaitForEvents(1, &event));
+        clReleaseEvent(event);
+    }
+
+    void set_kernel_arg(cl_kernel kernel, cl_uint index) override
+    {
+        clCheckError(clSetKernelArgSVMPointer(kernel, index, ptr));
+    }
+
+    void release() override
+    {
+        host_release();
+        if (ptr) clSVMFree(context, ptr);
+    }
+};
+
+// Buffer created on host memory owned by the caller (or allocated here when no
+// pointer is given): the runtime may use it directly instead of a copy.
+template <typename T>
+struct clMemHostPtr : clMemory<T>
+{
+    using super = clMemory<T>;
+    using super::context;
+    using super::queue;
+    using super::size;
+    using super::buffer_flags;
+    using super::buffer;
+    using super::ptr;
+
+    bool owns_ptr;
+
+    clMemHostPtr(cl_context context,
+                 cl_command_queue queue,
+                 size_t size,
+                 cl_mem_flags buffer_flags,
+                 T * host_ptr = NULL)
+    : super(context, queue, size, buffer_flags)
+    , owns_ptr(host_ptr == NULL)
+    {
+        cl_int status;
+        ptr = host_ptr;
+        if (owns_ptr) {
+            status = posix_memalign((void**)&ptr, AOCL_ALIGNMENT, size * sizeof(T));
+            if (status != 0) clCheckErrorMsg(-255, "Failed to create host buffer");
+        }
+
+        buffer = clCreateBuffer(context, CL_MEM_USE_HOST_PTR | buffer_flags,
+                                size * sizeof(T), ptr, &status);
+        clCheckErrorMsg(status, "Failed to create clBufferHostPtr");
+    }
+
+    void map(cl_map_flags, cl_event * = NULL, bool = true) override
+    {}
+
+    void read(cl_event * event = NULL, bool blocking = true,
+              cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        clCheckError(clEnqueueReadBuffer(queue, buffer, blocking,
+                                         0, size * sizeof(T), ptr,
+                                         num_wait, wait_list, event));
+    }
+
+    void write(cl_event * event = NULL, bool blocking = true,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        clCheckError(clEnqueueWriteBuffer(queue, buffer, blocking,
+                                          0, size * sizeof(T), ptr,
+                                          num_wait, wait_list, event));
+    }
+
+    void release() override
+    {
+        if (buffer) clReleaseMemObject(buffer);
+        if (ptr && owns_ptr) free(ptr);
+    }
+};
+
+// Same as clMemBuffer, but the host side lives on huge pages: hugetlbfs pages
+// when the system has some reserved, transparent huge pages otherwise.
+template <typename T>
+struct clMemHugePage : clMemory<T>
+{
+    using super = clMemory<T>;
+    using super::context;
+    using super::queue;
+    using super::size;
+    using super::buffer_flags;
+    using super::buffer;
+    using super::ptr;
+
+    size_t mapped_bytes;
+    bool hugetlb;
+
+    clMemHugePage(cl_context context,
+                  cl_command_queue queue,
+                  size_t size,
+                  cl_mem_flags buffer_flags)
+    : super(context, queue, size, buffer_flags)
+    {
+        cl_int status;
+        buffer = clCreateBuffer(context, buffer_flags, size * sizeof(T), NULL, &status);
+        clCheckErrorMsg(status, "Failed to create clBuffer");
+
+        mapped_bytes = (size * sizeof(T) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        hugetlb = true;
+        void * mem = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem == MAP_FAILED) {
+            hugetlb = false;
+            mem = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) clCheckErrorMsg(-255, "Failed to create host buffer");
+            madvise(mem, mapped_bytes, MADV_HUGEPAGE);
+        }
+        ptr = (T *)mem;
+    }
+
+    void map(cl_map_flags, cl_event * = NULL, bool = true) override
+    {}
+
+    void read(cl_event * event = NULL, bool blocking = true,
+              cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        clCheckError(clEnqueueReadBuffer(queue, buffer, blocking,
+                                         0, size * sizeof(T), ptr,
+                                         num_wait, wait_list, event));
+    }
+
+    void write(cl_event * event = NULL, bool blocking = true,
+               cl_uint num_wait = 0, const cl_event * wait_list = NULL) override
+    {
+        clCheckError(clEnqueueWriteBuffer(queue, buffer, blocking,
+                                          0, size * sizeof(T), ptr,
+                                          num_wait, wait_list, event));
+    }
+
+    void release() override
+    {
+        if (buffer) clReleaseMemObject(buffer);
+        if (ptr) munmap(ptr, mapped_bytes);
+    }
+};
+
+// A file mapped in the host address space: inputs are mapped read-only as they
+// are, outputs are created with `bytes` bytes and shared with the file, so the
+// transfers go straight between the page cache and the device.
+struct MappedFile
+{
+    int fd;
+    size_t bytes;
+    void * ptr;
+
+    MappedFile(const std::string & path, bool output, size_t bytes = 0)
+    : fd(-1)
+    , bytes(bytes)
+    , ptr(NULL)
+    {
+        fd = output ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                    : open(path.c_str(), O_RDONLY);
+        if (fd < 0) clCheckErrorMsg(-255, ("Failed to open " + path).c_str());
+
+        if (output) {
+            if (ftruncate(fd, bytes) != 0) clCheckErrorMsg(-255, ("Failed to resize " + path).c_str());
+        } else {
+            struct stat st;
+            if (fstat(fd, &st) != 0) clCheckErrorMsg(-255, ("Failed to stat " + path).c_str());
+            this->bytes = st.st_size;
+        }
+
+        ptr = mmap(NULL, this->bytes, output ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) clCheckErrorMsg(-255, ("Failed to map " + path).c_str());
+    }
+
+    // Writes the dirty pages of an output back to the file
+    void sync()
+    {
+        if (msync(ptr, bytes, MS_SYNC) != 0) clCheckErrorMsg(-255, "Failed to sync mapped file");
+    }
+
+    void release()
+    {
+        if (ptr) munmap(ptr, bytes);
+        if (fd >= 0) close(fd);
+    }
+};
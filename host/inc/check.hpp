@@ -0,0 +1,181 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#include "utils.hpp"
+#include "common.hpp"
+#include "types.hpp"
+
+#define CHECK_MAX_REPORTED  8
+
+struct Mismatch
+{
+    size_t iteration;
+    size_t index;
+    double expected;
+    double actual;
+
+    bool operator<(const Mismatch & other) const
+    {
+        return (iteration != other.iteration) ? iteration < other.iteration
+                                              : index < other.index;
+    }
+};
+
+// Outcome of the verification of one or more iterations
+struct CheckReport
+{
+    size_t checked;
+    size_t mismatches;
+    // The first CHECK_MAX_REPORTED mismatches, by iteration and index
+    std::vector<Mismatch> first;
+
+    CheckReport()
+    : checked(0)
+    , mismatches(0)
+    {}
+
+    void merge(const CheckReport & other)
+    {
+        checked += other.checked;
+        mismatches += other.mismatches;
+        first.insert(first.end(), other.first.begin(), other.first.end());
+        std::sort(first.begin(), first.end());
+        if (first.size() > CHECK_MAX_REPORTED) first.resize(CHECK_MAX_REPORTED);
+    }
+
+    void print(std::ostream & out = std::cout) const
+    {
+        out << "Check: " << mismatches << " mismatches in " << checked << " items\n";
+        for (const auto & m : first) {
+            out << std::setprecision(9)
+                << "       iteration " << m.iteration << " index " << m.index
+                << ": expected " << m.expected << ", got " << m.actual << "\n";
+        }
+    }
+};
+
+// Distance in units in the last place: floats are mapped to integers that are
+// ordered like the floats, so that adjacent floats differ by one.
+inline int64_t ulp_distance(float a, float b) __attribute__((always_inline));
+inline int64_t ulp_distance(float a, float b)
+{
+    int32_t ia;
+    int32_t ib;
+    std::memcpy(&ia, &a, sizeof(ia));
+    std::memcpy(&ib, &b, sizeof(ib));
+    ia = (ia < 0) ? INT32_MIN - ia : ia;
+    ib = (ib < 0) ? INT32_MIN - ib : ib;
+    return std::llabs(int64_t(ia) - int64_t(ib));
+}
+
+inline int64_t ulp_distance(double a, double b)
+{
+    int64_t ia;
+    int64_t ib;
+    std::memcpy(&ia, &a, sizeof(ia));
+    std::memcpy(&ib, &b, sizeof(ib));
+    ia = (ia < 0) ? INT64_MIN - ia : ia;
+    ib = (ib < 0) ? INT64_MIN - ib : ib;
+    const uint64_t d = (ia > ib) ? uint64_t(ia) - uint64_t(ib) : uint64_t(ib) - uint64_t(ia);
+    return (d > uint64_t(INT64_MAX)) ? INT64_MAX : int64_t(d);
+}
+
+inline int64_t ulp_distance(half a, half b)
+{
+    int32_t ia = int16_t(a.bits);
+    int32_t ib = int16_t(b.bits);
+    ia = (ia < 0) ? INT16_MIN - ia : ia;
+    ib = (ib < 0) ? INT16_MIN - ib : ib;
+    return std::llabs(int64_t(ia) - int64_t(ib));
+}
+
+// Integers must match exactly, whatever the tolerance
+template <typename T>
+inline int64_t ulp_distance(T a, T b)
+{
+    return (a == b) ? 0 : std::numeric_limits<int64_t>::max();
+}
+
+inline double item_value(half v)
+{
+    return half_to_float(v.bits);
+}
+
+template <typename T>
+inline double item_value(T v)
+{
+    return double(v);
+}
+
+// What the compute stage does to an item, with fma extra multiply-adds (only
+// float kernels have them)
+inline float compute_reference(float v, int fma)
+{
+    v = v * v;
+    for (int k = 0; k < fma; ++k) v = v * FMA_ALPHA + FMA_BETA;
+    return v;
+}
+
+inline double compute_reference(double v, int)
+{
+    return v * v;
+}
+
+inline half compute_reference(half v, int)
+{
+    const float f = half_to_float(v.bits);
+    return {float_to_half(f * f)};
+}
+
+// Integer products wrap around like on the device
+template <typename T>
+inline T compute_reference(T v, int)
+{
+    using U = typename std::make_unsigned<T>::type;
+    const uint64_t u = U(v);
+    return T(U(u * u));
+}
+
+// Checks dst[i] == compute_reference(src[i], fma) within max_ulps. Each thread
+// counts the mismatches of its chunk with a branchless (vectorizable) loop and
+// only looks for their indices when there are some.
+template <typename T>
+CheckReport check_computation(const T * src, const T * dst, size_t n,
+                              int max_ulps, size_t iteration, int fma = 0)
+{
+    CheckReport report;
+    report.checked = n;
+    std::mutex mutex;
+
+    parallel_for(n, [&](size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i) {
+            count += (ulp_distance(compute_reference(src[i], fma), dst[i]) > max_ulps);
+        }
+        if (count == 0) return;
+
+        CheckReport chunk;
+        chunk.mismatches = count;
+        for (size_t i = begin; i < end and chunk.first.size() < CHECK_MAX_REPORTED; ++i) {
+            const T v = compute_reference(src[i], fma);
+            if (ulp_distance(v, dst[i]) > max_ulps) {
+                chunk.first.push_back({iteration, i, item_value(v), item_value(dst[i])});
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        report.merge(chunk);
+    });
+
+    return report;
+}
@@ -1,8 +1,7 @@
 #pragma once
 
 #include <limits>
-
-#define FLT_EPSILON             std::numeric_limits<float>::epsilon()
+#include <string>
 
 #define KERNELS_FILENAME        "membench.cl"
 #define K_READER_SINGLE_NAME    "reader_single"
@@ -14,17 +13,102 @@
 #define K_READER_AUTORUN_NAME     "reader_autorun"
 #define K_COMPUTE_AUTORUN_NAME    "compute_autorun"
 #define K_WRITER_AUTORUN_NAME     "writer_autorun"
+#define K_RANGE_FUSED_NAME      "range_fused"
+#define K_VEC_SUFFIX            "_v"
+#define K_CU_SUFFIX             "_cu"
+#define K_READER_BLOCKED_NAME   "reader_blocked"
+#define K_COMPUTE_BLOCKED_NAME  "compute_blocked"
+#define K_WRITER_BLOCKED_NAME   "writer_blocked"
+#define K_READER_GATHER_NAME    "reader_gather"
+#define K_COMPUTE_GATHER_NAME   "compute_gather"
+#define K_WRITER_SCATTER_NAME   "writer_scatter"
+#define K_READER_BANK_NAME      "reader_bank"
+#define K_COMPUTE_BANK_NAME     "compute_bank"
+#define K_WRITER_BANK_NAME      "writer_bank"
+#define K_LAUNCH_NAME           "launch_single"
+#define K_READER_PERSISTENT_NAME    "reader_persistent"
+#define K_COMPUTE_PERSISTENT_NAME   "compute_persistent"
+#define K_WRITER_PERSISTENT_NAME    "writer_persistent"
+#define STREAM_STOP             -2
+
+#define MAX_VEC_WIDTH           16
+#define FMA_ALPHA               0.75f
+#define FMA_BETA                0.5f
+#define WORK_GROUP_SIZE_X       16
+// Must match AUTORUN_VEC in device/membench.cl
+#define AUTORUN_VEC             4
+#define MAX_AUTORUN_UNITS       16
 
 
 enum clKernelType
 {
     Task,
     NDRange,
-    Autorun
+    Autorun,
+    MultiBank,
+    CPU
 };
 
 enum clMemoryType
 {
     Buffer,
-    Shared
+    Shared,
+    SVM,
+    HostPtr,
+    HugePage
+};
+
+// Element types of the sequential Task and NDRange kernels, float first as
+// the default of every other benchmark
+enum clDataType
+{
+    Float,
+    Int8,
+    Int16,
+    Int32,
+    Half,
+    Double
+};
+
+// Work-group size, SIMD width and compute units of a fused NDRange kernel
+struct SimdVariant
+{
+    int wg;
+    int simd;
+    int cus;
+
+    std::string kernel_name() const
+    {
+        return K_RANGE_FUSED_NAME "_wg" + std::to_string(wg) + "_simd" + std::to_string(simd)
+               + K_CU_SUFFIX + std::to_string(cus);
+    }
+};
+
+enum clAccessPattern
+{
+    Sequential,
+    Blocked,
+    Gather
+};
+
+// Order in which the reader and writer visit the items. Blocked visits blocks
+// of `block` items `stride` blocks apart: a block of 1 item is a strided access.
+struct AccessPattern
+{
+    clAccessPattern type;
+    int stride;
+    int block;
+
+    std::string name() const
+    {
+        switch (type) {
+            case Blocked:
+                return (block == 1) ? "strided " + std::to_string(stride)
+                                    : "blocked " + std::to_string(stride) + "x" + std::to_string(block);
+            case Gather:
+                return "gather/scatter";
+            default:
+                return "sequential";
+        }
+    }
 };
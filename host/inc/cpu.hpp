@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
+
+#include "utils.hpp"
+
+// Depth of the device channels, mirrored by the host queues
+#define CHANNEL_DEPTH   32
+#define CACHE_LINE_SIZE 64
+
+// Lock-free single-producer single-consumer ring of DEPTH items, the host
+// counterpart of an Intel channel: push() and pop() block while the ring is
+// full or empty. Each side owns a cache line with its counter and a copy of
+// the other side's one, which it only reloads when the ring looks full (or
+// empty), so that the counters do not bounce between cores at every item.
+template <typename T, int DEPTH = CHANNEL_DEPTH>
+struct SPSCQueue
+{
+    T items[DEPTH];
+
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head;
+    uint64_t tail_cache;
+
+    // Producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail;
+    uint64_t head_cache;
+    char pad[CACHE_LINE_SIZE];
+
+    SPSCQueue()
+    : head(0)
+    , tail_cache(0)
+    , tail(0)
+    , head_cache(0)
+    {}
+
+    void push(const T & item)
+    {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        while (t - head_cache == DEPTH) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache == DEPTH) spin_wait();
+        }
+        items[t % DEPTH] = item;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    T pop()
+    {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        while (tail_cache == h) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (tail_cache == h) spin_wait();
+        }
+        const T item = items[h % DEPTH];
+        head.store(h + 1, std::memory_order_release);
+        return item;
+    }
+
+    // Stages may outnumber the cores, so a waiting side gives its core away
+    static void spin_wait()
+    {
+        std::this_thread::yield();
+    }
+};
+
+// Array of n default-constructed items aligned to a cache line. Before C++17
+// std::allocator ignores over-aligned types, so a std::vector of queues would
+// not keep their counters on cache lines of their own.
+template <typename T>
+struct AlignedArray
+{
+    T * items;
+    size_t n;
+
+    explicit AlignedArray(size_t n)
+    : items(NULL)
+    , n(n)
+    {
+        void * ptr = NULL;
+        if (posix_memalign(&ptr, CACHE_LINE_SIZE, n * sizeof(T)) != 0) throw std::bad_alloc();
+        items = static_cast<T *>(ptr);
+        for (size_t i = 0; i < n; ++i) new (items + i) T();
+    }
+
+    ~AlignedArray()
+    {
+        for (size_t i = 0; i < n; ++i) items[i].~T();
+        free(items);
+    }
+
+    AlignedArray(const AlignedArray &) = delete;
+    AlignedArray & operator=(const AlignedArray &) = delete;
+
+    T & operator[](size_t i) { return items[i]; }
+};
+
+// Start and end of a pipeline stage, in nanoseconds
+struct StageTime
+{
+    uint64_t start;
+    uint64_t end;
+};
+
+// Runs reader, compute and writer as threads joined by SPSC queues, with the
+// compute stage split over `units` threads fed round-robin like
+// compute_autorun. times[0-2] receive the reader, compute and writer spans,
+// the compute one from the first unit start to the last unit end.
+inline void cpu_pipeline(const float * src, float * dst, size_t n, int units, StageTime times[3])
+{
+    AlignedArray<SPSCQueue<float>> in(units);
+    AlignedArray<SPSCQueue<float>> out(units);
+    std::vector<StageTime> compute_times(units);
+
+    std::thread reader([&]() {
+        times[0].start = current_time_ns();
+        for (size_t i = 0; i < n; ++i) in[i % units].push(src[i]);
+        times[0].end = current_time_ns();
+    });
+
+    std::vector<std::thread> computes;
+    for (int c = 0; c < units; ++c) {
+        computes.emplace_back([&, c]() {
+            compute_times[c].start = current_time_ns();
+            for (size_t i = c; i < n; i += units) {
+                const float val = in[c].pop();
+                out[c].push(val * val);
+            }
+            compute_times[c].end = current_time_ns();
+        });
+    }
+
+    std::thread writer([&]() {
+        times[2].start = current_time_ns();
+        for (size_t i = 0; i < n; ++i) dst[i] = out[i % units].pop();
+        times[2].end = current_time_ns();
+    });
+
+    reader.join();
+    for (auto & c : computes) c.join();
+    writer.join();
+
+    times[1].start = compute_times[0].start;
+    times[1].end = compute_times[0].end;
+    for (const auto & t : compute_times) {
+        times[1].start = std::min(times[1].start, t.start);
+        times[1].end = std::max(times[1].end, t.end);
+    }
+}
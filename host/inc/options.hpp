@@ -1,9 +1,18 @@
 #pragma once
 
 #include <iostream>
+#include <cstdio>
 #include <iomanip>
 #include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <getopt.h>
+#include <sys/stat.h>
+
+#include "common.hpp"
+#include "types.hpp"
 
 using namespace std;
 
@@ -12,26 +21,98 @@ struct Options
     string aocx_filename;
     int platform;
     int device;
+    // Devices benchmarked concurrently, all of the platform when empty
+    vector<int> devices;
+    bool multi_device;
     int iterations;
-    int size;
+    int warmup;
+    size_t size;
+    int inflight;
+    int window;
+    bool out_of_order;
+    int pool;
+    vector<int> vec_widths;
+    vector<int> fmas;
+    vector<clDataType> data_types;
+    vector<AccessPattern> patterns;
+    bool sweep;
+    size_t sweep_min;
+    size_t sweep_max;
+    size_t sweep_factor;
     bool task;
     bool range;
     bool autorun;
+    vector<int> autorun_units;
+    // Whether autorun_units came from `all`, trimmed to the units built
+    bool autorun_all_units;
+    vector<SimdVariant> simd_variants;
+    // Whether simd_variants came from `all`, trimmed to the variants built
+    bool simd_all;
     bool buffer;
     bool shared;
+    bool svm;
+    bool hostptr;
+    bool hugepage;
+    int src_bank;
+    int dst_bank;
+    int banks;
+    bool launch;
+    bool persistent;
+    bool duplex;
+    size_t dataset;
+    string input;
+    string output;
+    int cpu;
+    int fastflow;
     bool check_results;
+    int max_ulps;
 
     Options()
     : aocx_filename("./membench.aocx")
     , platform(0)
     , device(0)
+    , devices()
+    , multi_device(false)
     , iterations(32)
+    , warmup(0)
     , size(1024)
+    , inflight(1)
+    , window(0)
+    , out_of_order(false)
+    , pool(0)
+    , vec_widths(1, 1)
+    , fmas(1, 0)
+    , data_types(1, clDataType::Float)
+    , patterns(1, AccessPattern{clAccessPattern::Sequential, 1, 1})
+    , sweep(false)
+    , sweep_min(0)
+    , sweep_max(0)
+    , sweep_factor(2)
     , task(false)
     , range(false)
+    , autorun(false)
+    , autorun_units()
+    , autorun_all_units(false)
+    , simd_variants()
+    , simd_all(false)
     , buffer(false)
     , shared(false)
+    , svm(false)
+    , hostptr(false)
+    , hugepage(false)
+    , src_bank(0)
+    , dst_bank(0)
+    , banks(0)
+    , launch(false)
+    , persistent(false)
+    , duplex(false)
+    , dataset(0)
+    , input()
+    , output()
+    , cpu(0)
+    , fastflow(0)
     , check_results(false)
+    , max_ulps(4)
     {}
 
     void print_help()
@@ -39,34 +120,327 @@ struct Options
         cout << "\t-f  --aocx            Specify the path of the .aocx file     \n"
                 "\t-p  --platform        Specify the OpenCL platform index      \n"
                 "\t-d  --device          Specify the OpenCL device index        \n"
+                "\t-e  --devices         Benchmark devices concurrently (e.g. 0,1|all)\n"
                 "\t-i  --iterations      Set the number of iterations           \n"
+                "\t-k  --warmup          Set the number of discarded iterations \n"
                 "\t-n  --size            Set the number of items per iteration  \n"
+                "\t-l  --inflight        Set the number of iterations in flight \n"
+                "\t-W  --window          Synchronize once every N iterations    \n"
+                "\t-o  --ooo             Use out-of-order command queues        \n"
+                "\t-g  --pool            Pre-generate a pool of input datasets  \n"
+                "\t-v  --vector          Set the vector widths (e.g. 1,4,16|all)\n"
+                "\t-T  --type            Set the data types (e.g. float,int16|all)\n"
+                "\t                      (other than float need TYPE_KERNELS=1)\n"
+                "\t-F  --fma             Set the multiply-adds per item (e.g. 0,4,64)\n"
+                "\t-x  --pattern         Set the access patterns of clEnqueueTask()\n"
+                "\t                      (seq,strided:S,blocked:S:B,gather)     \n"
+                "\t-w  --sweep           Sweep batch bytes min:max:factor (e.g. 1K:1G:2)\n"
                 "\t-t  --task            Benchmark clEnqueueTask().             \n"
                 "\t-r  --range           Benchmark clEnqueueNDRangeKernel()     \n"
                 "\t-a  --autorun         Benchmark Autorun kenrel               \n"
+                "\t-U  --autorun-cus     Benchmark Autorun kernels with U units (e.g. 1,4|all)\n"
+                "\t-G  --simd            Benchmark fused NDRange kernels WG:SIMD[:CU] (e.g. 64:4|all)\n"
+                "\t                      (needs SIMD_KERNELS=1, CU above 1 SIMD_CU_MAX)\n"
                 "\t-b  --buffer          Benchmark clEnqueue[Read/Write]Buffer()\n"
                 "\t-s  --shared          Benchmark clEnqueue[Map/Unmap]Buffer() \n"
+                "\t-m  --svm             Benchmark Shared Virtual Memory        \n"
+                "\t-y  --hostptr         Benchmark CL_MEM_USE_HOST_PTR buffers  \n"
+                "\t-z  --hugepage        Benchmark huge page host buffers       \n"
+                "\t-B  --bank            Place src and dst in memory banks S:D  \n"
+                "\t-P  --per-bank        Benchmark N concurrent bank pipelines  \n"
+                "\t                      (N_BANKS pipelines are built, 2 by default)\n"
+                "\t-L  --launch          Benchmark the launch of empty kernels  \n"
+                "\t-S  --persistent      Benchmark persistent streaming kernels \n"
+                "\t-X  --duplex          Benchmark writes and reads in full duplex\n"
+                "\t-D  --dataset         Stream a dataset of N bytes in chunks of --size items\n"
+                "\t-I  --input           Stream the float items of a file as the dataset\n"
+                "\t-O  --output          Write the streamed results to a file   \n"
+                "\t-C  --cpu             Benchmark CPU threads with N compute units\n"
+                "\t-j  --fastflow        Run the host side on FastFlow, N workers per farm\n"
                 "\t-c  --check           Check results of computation           \n"
+                "\t-u  --ulp             Set the tolerance of the check in ULPs \n"
                 "\t-h  --help            Show this help message and exit        \n";
         exit(1);
     }
 
+    static vector<int> parse_vec_widths(const string & arg)
+    {
+        vector<int> widths;
+        if (arg == "all") {
+            for (int w = 1; w <= MAX_VEC_WIDTH; w *= 2) widths.push_back(w);
+            return widths;
+        }
+
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            const int w = stoi(item);
+            if (w < 1 or w > MAX_VEC_WIDTH or (w & (w - 1)) != 0) {
+                cerr << "Please enter valid vector widths (1, 2, 4, 8 or 16)" << endl;
+                exit(1);
+            }
+            widths.push_back(w);
+        }
+        return widths;
+    }
+
+    static vector<int> parse_devices(const string & arg)
+    {
+        vector<int> devices;
+        if (arg == "all") return devices;
+
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            const int d = stoi(item);
+            if (d < 0 or find(devices.begin(), devices.end(), d) != devices.end()) {
+                cerr << "Please enter a list of distinct devices" << endl;
+                exit(1);
+            }
+            devices.push_back(d);
+        }
+        return devices;
+    }
+
+    // Sorted and without repetitions, so that the first is the baseline of
+    // the scaling table
+    static vector<int> parse_units(const string & arg)
+    {
+        vector<int> units;
+        if (arg == "all") {
+            for (int u = 1; u <= MAX_AUTORUN_UNITS; u *= 2) units.push_back(u);
+            return units;
+        }
+
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            const int u = stoi(item);
+            if (u < 1 or u > MAX_AUTORUN_UNITS or (u & (u - 1)) != 0) {
+                cerr << "Please enter valid numbers of compute units (1, 2, 4, 8 or 16)" << endl;
+                exit(1);
+            }
+            units.push_back(u);
+        }
+        sort(units.begin(), units.end());
+        units.erase(unique(units.begin(), units.end()), units.end());
+        return units;
+    }
+
+    // Work-group sizes, SIMD widths and compute units of the fused NDRange
+    // kernels, WG:SIMD[:CU] with a single compute unit by default
+    static vector<SimdVariant> parse_simd(const string & arg)
+    {
+        const vector<int> wgs = {16, 64, 256};
+        const vector<int> simds = {1, 4, 16};
+        const vector<int> cus = {1, 2, 4};
+        vector<SimdVariant> variants;
+        if (arg == "all") {
+            for (int cu : cus) {
+                for (int wg : wgs) {
+                    for (int simd : simds) variants.push_back({wg, simd, cu});
+                }
+            }
+            return variants;
+        }
+
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            stringstream fields(item);
+            string field;
+            vector<int> values;
+            while (getline(fields, field, ':')) values.push_back(stoi(field));
+            values.resize(3, 1);
+            const SimdVariant variant = {values[0], values[1], values[2]};
+            if (find(wgs.begin(), wgs.end(), variant.wg) == wgs.end() or
+                find(simds.begin(), simds.end(), variant.simd) == simds.end() or
+                find(cus.begin(), cus.end(), variant.cus) == cus.end()) {
+                cerr << "Please enter valid work-group sizes (16, 64 or 256), SIMD widths (1, 4 or 16) "
+                        "and compute units (1, 2 or 4)" << endl;
+                exit(1);
+            }
+            variants.push_back(variant);
+        }
+        return variants;
+    }
+
+    static vector<int> parse_fmas(const string & arg)
+    {
+        vector<int> fmas;
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            const int f = stoi(item);
+            if (f < 0) {
+                cerr << "Please enter valid numbers of multiply-adds per item" << endl;
+                exit(1);
+            }
+            fmas.push_back(f);
+        }
+        return fmas;
+    }
+
+    static vector<clDataType> parse_data_types(const string & arg)
+    {
+        const char * names[] = {"float", "int8", "int16", "int32", "half", "double"};
+        vector<clDataType> types;
+        if (arg == "all") {
+            for (int t = clDataType::Float; t <= clDataType::Double; ++t) types.push_back(clDataType(t));
+            return types;
+        }
+
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            const auto name = find(begin(names), end(names), item);
+            if (name == end(names)) {
+                cerr << "Please enter valid data types (float, int8, int16, int32, half or double)" << endl;
+                exit(1);
+            }
+            types.push_back(clDataType(name - begin(names)));
+        }
+        return types;
+    }
+
+    static vector<AccessPattern> parse_patterns(const string & arg)
+    {
+        vector<AccessPattern> list;
+        stringstream ss(arg);
+        string item;
+        while (getline(ss, item, ',')) {
+            stringstream fields(item);
+            string kind;
+            string value;
+            vector<int> values;
+            getline(fields, kind, ':');
+            while (getline(fields, value, ':')) values.push_back(stoi(value));
+
+            if (kind == "seq" and values.empty()) {
+                list.push_back({clAccessPattern::Sequential, 1, 1});
+            } else if (kind == "strided" and values.size() == 1 and values[0] > 0) {
+                list.push_back({clAccessPattern::Blocked, values[0], 1});
+            } else if (kind == "blocked" and values.size() == 2 and values[0] > 0 and values[1] > 0) {
+                list.push_back({clAccessPattern::Blocked, values[0], values[1]});
+            } else if (kind == "gather" and values.empty()) {
+                list.push_back({clAccessPattern::Gather, 1, 1});
+            } else {
+                cerr << "Please enter valid access patterns (seq,strided:S,blocked:S:B,gather)" << endl;
+                exit(1);
+            }
+        }
+        return list;
+    }
+
+    // Parses a byte count with an optional K, M or G (binary) suffix
+    static size_t parse_bytes(const string & arg)
+    {
+        size_t pos = 0;
+        size_t bytes = stoull(arg, &pos);
+        if (pos < arg.size()) {
+            switch (toupper(arg[pos])) {
+                case 'K': bytes <<= 10; break;
+                case 'M': bytes <<= 20; break;
+                case 'G': bytes <<= 30; break;
+                default:
+                    cerr << "Please enter a valid size suffix (K, M or G)" << endl;
+                    exit(1);
+            }
+        }
+        return bytes;
+    }
+
+    void parse_sweep(const string & arg)
+    {
+        const size_t first = arg.find(':');
+        const size_t second = arg.find(':', first + 1);
+        if (first == string::npos) {
+            cerr << "Please enter a valid sweep as min:max[:factor]" << endl;
+            exit(1);
+        }
+
+        sweep_min = parse_bytes(arg.substr(0, first));
+        sweep_max = parse_bytes(arg.substr(first + 1, second - first - 1));
+        if (second != string::npos) sweep_factor = stoull(arg.substr(second + 1));
+
+        if (sweep_min == 0 or sweep_max < sweep_min or sweep_factor < 2) {
+            cerr << "Please enter a valid sweep as min:max[:factor]" << endl;
+            exit(1);
+        }
+        sweep = true;
+    }
+
+    // Items per iteration of every run: either --size or the sweep points.
+    // Sweep points are rounded down to whole NDRange work-groups of the
+    // widest vector kernel.
+    // Size of the widest element type selected, which sets how many items fit
+    // in the batch bytes of a sweep
+    size_t item_bytes() const
+    {
+        size_t bytes = sizeof(float);
+        for (auto data_type : data_types) bytes = max(bytes, data_type_size(data_type));
+        return bytes;
+    }
+
+    vector<size_t> sizes() const
+    {
+        if (!sweep) return vector<size_t>(1, size);
+
+        const size_t align = MAX_VEC_WIDTH * WORK_GROUP_SIZE_X;
+        vector<size_t> points;
+        for (size_t bytes = sweep_min; bytes <= sweep_max; bytes *= sweep_factor) {
+            const size_t items = bytes / item_bytes() / align * align;
+            if (items > 0 and (points.empty() or points.back() != items)) {
+                points.push_back(items);
+            }
+        }
+        return points;
+    }
+
     void process_args(int argc, char * argv[])
     {
         opterr = 0;
 
-        const char * const short_opts = "f:p:d:i:n:trabsch";
+        const char * const short_opts = "f:p:d:e:i:k:n:l:W:g:v:T:F:x:w:u:B:P:C:j:D:I:O:U:G:otrabsmyzLSXch";
         const option long_opts[] = {
                 {"aocx",       optional_argument, nullptr, 'f'},
                 {"platform",   optional_argument, nullptr, 'p'},
                 {"device",     optional_argument, nullptr, 'd'},
+                {"devices",    required_argument, nullptr, 'e'},
                 {"iterations", optional_argument, nullptr, 'i'},
+                {"warmup",     required_argument, nullptr, 'k'},
                 {"size",       optional_argument, nullptr, 'n'},
+                {"inflight",   required_argument, nullptr, 'l'},
+                {"window",     required_argument, nullptr, 'W'},
+                {"ooo",        no_argument,       nullptr, 'o'},
+                {"pool",       required_argument, nullptr, 'g'},
+                {"vector",     required_argument, nullptr, 'v'},
+                {"type",       required_argument, nullptr, 'T'},
+                {"fma",        required_argument, nullptr, 'F'},
+                {"pattern",    required_argument, nullptr, 'x'},
+                {"sweep",      required_argument, nullptr, 'w'},
                 {"task",       optional_argument, nullptr, 't'},
                 {"range",      optional_argument, nullptr, 'r'},
+                {"autorun",    optional_argument, nullptr, 'a'},
+                {"autorun-cus", required_argument, nullptr, 'U'},
+                {"simd",       required_argument, nullptr, 'G'},
                 {"buffer",     optional_argument, nullptr, 'b'},
                 {"shared",     optional_argument, nullptr, 's'},
+                {"svm",        optional_argument, nullptr, 'm'},
+                {"hostptr",    optional_argument, nullptr, 'y'},
+                {"hugepage",   optional_argument, nullptr, 'z'},
+                {"bank",       required_argument, nullptr, 'B'},
+                {"per-bank",   required_argument, nullptr, 'P'},
+                {"launch",     no_argument,       nullptr, 'L'},
+                {"persistent", no_argument,       nullptr, 'S'},
+                {"duplex",     no_argument,       nullptr, 'X'},
+                {"dataset",    required_argument, nullptr, 'D'},
+                {"input",      required_argument, nullptr, 'I'},
+                {"output",     required_argument, nullptr, 'O'},
+                {"cpu",        required_argument, nullptr, 'C'},
+                {"fastflow",   required_argument, nullptr, 'j'},
                 {"check",      optional_argument, nullptr, 'c'},
+                {"ulp",        required_argument, nullptr, 'u'},
                 {"help",       no_argument,       nullptr, 'h'},
                 {nullptr,      no_argument,       nullptr,   0}
         };
@@ -96,6 +470,10 @@ struct Options
                     }
                     device = int_opt;
                     break;
+                case 'e':
+                    devices = parse_devices(optarg);
+                    multi_device = true;
+                    break;
                 case 'i':
                     if ((int_opt = stoi(optarg)) < 0) {
                         cerr << "Please enter a valid number of iterations" << endl;
@@ -103,12 +481,58 @@ struct Options
                     }
                     iterations = int_opt;
                     break;
+                case 'k':
+                    if ((int_opt = stoi(optarg)) < 0) {
+                        cerr << "Please enter a valid number of warmup iterations" << endl;
+                        exit(1);
+                    }
+                    warmup = int_opt;
+                    break;
                 case 'n':
-                    if ((int_opt = atoi(optarg)) < 0) {
+                    if (optarg[0] == '-') {
                         cerr << "Please enter a valid number of items per iteration" << endl;
                         exit(1);
                     }
-                    size = int_opt;
+                    size = stoull(optarg);
+                    break;
+                case 'l':
+                    if ((int_opt = stoi(optarg)) < 1) {
+                        cerr << "Please enter a valid number of iterations in flight" << endl;
+                        exit(1);
+                    }
+                    inflight = int_opt;
+                    break;
+                case 'W':
+                    if ((int_opt = stoi(optarg)) < 1) {
+                        cerr << "Please enter a valid synchronization window" << endl;
+                        exit(1);
+                    }
+                    window = int_opt;
+                    break;
+                case 'o':
+                    out_of_order = true;
+                    break;
+                case 'g':
+                    if ((int_opt = stoi(optarg)) < 0) {
+                        cerr << "Please enter a valid number of pooled datasets" << endl;
+                        exit(1);
+                    }
+                    pool = int_opt;
+                    break;
+                case 'v':
+                    vec_widths = parse_vec_widths(optarg);
+                    break;
+                case 'T':
+                    data_types = parse_data_types(optarg);
+                    break;
+                case 'F':
+                    fmas = parse_fmas(optarg);
+                    break;
+                case 'x':
+                    patterns = parse_patterns(optarg);
+                    break;
+                case 'w':
+                    parse_sweep(optarg);
                     break;
                 case 't':
                     task = true;
@@ -119,15 +543,93 @@ struct Options
                 case 'a':
                     autorun = true;
                     break;
+                case 'U':
+                    autorun_units = parse_units(optarg);
+                    autorun_all_units = (string(optarg) == "all");
+                    break;
+                case 'G':
+                    simd_variants = parse_simd(optarg);
+                    simd_all = (string(optarg) == "all");
+                    break;
                 case 'b':
                     buffer = true;
                     break;
                 case 's':
                     shared = true;
                     break;
+                case 'm':
+                    svm = true;
+                    break;
+                case 'y':
+                    hostptr = true;
+                    break;
+                case 'z':
+                    hugepage = true;
+                    break;
+                case 'B':
+                    if (sscanf(optarg, "%d:%d", &src_bank, &dst_bank) != 2 or
+                        src_bank < 0 or src_bank > 7 or dst_bank < 0 or dst_bank > 7) {
+                        cerr << "Please enter valid memory banks as S:D (0 interleaved, 1-7)" << endl;
+                        exit(1);
+                    }
+                    break;
+                case 'P':
+                    if ((int_opt = stoi(optarg)) < 1 or int_opt > 4) {
+                        cerr << "Please enter a valid number of memory banks (1-4)" << endl;
+                        exit(1);
+                    }
+                    banks = int_opt;
+                    break;
+                case 'L':
+                    launch = true;
+                    break;
+                case 'S':
+                    persistent = true;
+                    break;
+                case 'X':
+                    duplex = true;
+                    break;
+                case 'D':
+                    if ((dataset = parse_bytes(optarg)) == 0) {
+                        cerr << "Please enter a valid dataset size" << endl;
+                        exit(1);
+                    }
+                    break;
+                case 'I':
+                    input = string(optarg);
+                    break;
+                case 'O':
+                    output = string(optarg);
+                    break;
+                case 'C':
+                    if ((int_opt = stoi(optarg)) < 1) {
+                        cerr << "Please enter a valid number of CPU compute units" << endl;
+                        exit(1);
+                    }
+                    cpu = int_opt;
+                    break;
+                case 'j':
+#ifdef FASTFLOW
+                    if ((int_opt = stoi(optarg)) < 1) {
+                        cerr << "Please enter a valid number of FastFlow workers" << endl;
+                        exit(1);
+                    }
+                    fastflow = int_opt;
+#else
+                    cerr << "Please rebuild with FASTFLOW=1 to use `--fastflow`" << endl;
+                    exit(1);
+#endif
+                    break;
                 case 'c':
                     check_results = true;
                     break;
+                case 'u':
+                    if ((int_opt = stoi(optarg)) < 0) {
+                        cerr << "Please enter a valid number of ULPs" << endl;
+                        exit(1);
+                    }
+                    max_ulps = int_opt;
+                    break;
                 case 'h':
                 case '?':
                 default:
@@ -136,14 +638,99 @@ struct Options
             }
         }
 
-        if (!task and !range and !autorun) {
-            cerr << "Please specify at least one of `--task`, `--range` and `--autorun`!\n";
+        // The FastFlow pipeline retires every iteration as it flows through,
+        // it has no synchronization points to group into windows
+        if (fastflow > 0 and window > 0) {
+            cerr << "Please choose either `--window` or `--fastflow`" << endl;
+            exit(1);
+        }
+
+        // Every iteration of a window needs its own buffers, since they are
+        // only reused once the whole window has been synchronized
+        if (window > 0) inflight = window;
+
+        // An input file is the dataset, or its first --dataset bytes
+        if (!input.empty()) {
+            struct stat st;
+            if (stat(input.c_str(), &st) != 0 or st.st_size == 0) {
+                cerr << "Please enter a readable, non-empty input file" << endl;
+                exit(1);
+            }
+            dataset = (dataset > 0) ? min(dataset, size_t(st.st_size)) : size_t(st.st_size);
+        }
+        if (!output.empty() and dataset == 0) {
+            cerr << "Please specify `--dataset` or `--input` to write an output file" << endl;
+            exit(1);
+        }
+
+        if (!task and !range and !autorun and autorun_units.empty() and simd_variants.empty() and !banks and !launch and !persistent and !duplex and !dataset and !cpu) {
+            cerr << "Please specify at least one of `--task`, `--range`, `--autorun`, `--autorun-cus`, `--simd`, "
+                    "`--per-bank`, `--launch`, `--persistent`, `--duplex`, `--dataset` and `--cpu`!\n";
             return;
         }
 
-        if (!buffer and !shared) {
-            cerr << "Please specify at least one of `--buffer` and `--shared`!\n";
+        if (!buffer and !shared and !svm and !hostptr and !hugepage and !banks and !launch and !persistent and !duplex and !dataset and !cpu) {
+            cerr << "Please specify at least one of `--buffer`, `--shared`, `--svm`, "
+                    "`--hostptr` and `--hugepage`!\n";
             return;
         }
+
+        if ((src_bank or dst_bank) and (shared or svm or hostptr or hugepage)) {
+            cerr << "Memory banks apply to `--buffer` only, not to host-side memory types" << endl;
+            exit(1);
+        }
+
+        for (const auto & p : patterns) {
+            for (size_t n : sizes()) {
+                if (n % p.block != 0) {
+                    cerr << "The number of items per iteration must be a multiple of the block " << p.block << endl;
+                    exit(1);
+                }
+                // The index buffer of gathers and scatters holds int items
+                if (p.type == clAccessPattern::Gather and n > size_t(numeric_limits<int>::max())) {
+                    cerr << "Gathers and scatters are limited to " << numeric_limits<int>::max() << " items" << endl;
+                    exit(1);
+                }
+            }
+        }
+
+        for (size_t n : sizes()) {
+            // The ring of the persistent kernels is indexed with int items
+            if (persistent and n * inflight > size_t(numeric_limits<int>::max())) {
+                cerr << "The ring of persistent chunks is limited to " << numeric_limits<int>::max() << " items" << endl;
+                exit(1);
+            }
+            if (dataset > 0 and dataset / sizeof(float) < n) {
+                cerr << "The dataset must hold at least one chunk of " << n << " items" << endl;
+                exit(1);
+            }
+        }
+
+        if (!autorun_units.empty() and !sweep and size % AUTORUN_VEC != 0) {
+            cerr << "The number of items per iteration must be a multiple of " << AUTORUN_VEC
+                 << " for the scalable Autorun kernels" << endl;
+            exit(1);
+        }
+
+        for (const auto & variant : simd_variants) {
+            if (!sweep and size % variant.wg != 0) {
+                cerr << "The number of items per iteration must be a multiple of the work-group size "
+                     << variant.wg << endl;
+                exit(1);
+            }
+        }
+
+        for (int w : vec_widths) {
+            if (!sweep and size % w != 0) {
+                cerr << "The number of items per iteration must be a multiple of the vector width " << w << endl;
+                exit(1);
+            }
+            // NDRange kernels run size / w work-items in work-groups of WORK_GROUP_SIZE_X
+            if (range and !sweep and (size / w) % WORK_GROUP_SIZE_X != 0) {
+                cerr << "The number of items per iteration must be a multiple of " << w * WORK_GROUP_SIZE_X
+                     << " for `--range` with vector width " << w << endl;
+                exit(1);
+            }
+        }
     }
 };
\ No newline at end of file
@@ -0,0 +1,461 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "opencl.hpp"
+#include "check.hpp"
+
+// Distribution of the per-iteration samples of one stage
+struct Stats
+{
+    double min;
+    double median;
+    double mean;
+    double p95;
+    double p99;
+    double max;
+    double stddev;
+
+    Stats(std::vector<cl_ulong> samples)
+    : min(0), median(0), mean(0), p95(0), p99(0), max(0), stddev(0)
+    {
+        if (samples.empty()) return;
+
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+
+        double sum = 0;
+        for (auto s : samples) sum += s;
+        mean = sum / n;
+
+        double sq = 0;
+        for (auto s : samples) sq += (s - mean) * (s - mean);
+        stddev = std::sqrt(sq / n);
+
+        min    = samples.front();
+        max    = samples.back();
+        median = percentile(samples, 50);
+        p95    = percentile(samples, 95);
+        p99    = percentile(samples, 99);
+    }
+
+    // Nearest-rank percentile of sorted samples
+    static double percentile(const std::vector<cl_ulong> & sorted, int p)
+    {
+        size_t rank = (p * sorted.size() + 99) / 100;
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+};
+
+// Timings of a benchmark run, all in nanoseconds
+struct Results
+{
+    size_t iterations;
+    size_t size;
+    // Floating point operations of the compute stage per item
+    int flops;
+    // Size of an item
+    int bytes;
+    cl_ulong t_host;
+    // Host clock at the start of the timed window, to line up concurrent runs
+    cl_ulong t_start;
+    // Queues, kernels and buffers set up before the first iteration
+    cl_ulong t_setup;
+    // 0 reader, 1 compute, 2 writer, 3 read, 4 write
+    cl_ulong timings[5];
+    // From the first kernel start to the last kernel end of each iteration
+    cl_ulong t_kernels;
+    std::vector<cl_ulong> samples[5];
+    CheckReport check;
+
+    Results(size_t iterations, size_t size, int flops = 1, int bytes = sizeof(float))
+    : iterations(iterations)
+    , size(size)
+    , flops(flops)
+    , bytes(bytes)
+    , t_host(0)
+    , t_start(0)
+    , t_setup(0)
+    , timings{0, 0, 0, 0, 0}
+    , t_kernels(0)
+    {}
+
+    void add_sample(int stage, cl_ulong t)
+    {
+        timings[stage] += t;
+        samples[stage].push_back(t);
+    }
+
+    size_t total_bytes() const
+    {
+        return size_t(iterations) * size * bytes;
+    }
+
+    // The compute stage both reads and writes every item
+    double bandwidth(int stage) const
+    {
+        return total_bytes() / (double)timings[stage] * (stage == 1 ? 2 : 1);
+    }
+
+    // Kernels end to end, like the compute stage every item is read and written
+    double kernels_bandwidth() const
+    {
+        return 2 * total_bytes() / (double)t_kernels;
+    }
+
+    double host_bandwidth() const
+    {
+        return total_bytes() / (double)t_host;
+    }
+
+    // GFLOP/s of the compute stage and its FLOPs per byte moved through it
+    double gflops() const
+    {
+        return size_t(iterations) * size * flops / (double)timings[1];
+    }
+
+    double intensity() const
+    {
+        return flops / (2.0 * bytes);
+    }
+};
+
+void print_results(const Results & r, std::ostream & out = std::cout)
+{
+    // All timings are in nanoseconds but printed in milliseconds
+    cl_ulong t_reader   = r.timings[0];
+    cl_ulong t_compute  = r.timings[1];
+    cl_ulong t_writer   = r.timings[2];
+    cl_ulong t_read     = r.timings[3];
+    cl_ulong t_write    = r.timings[4];
+    double tavg_reader  = t_reader  / (double)r.iterations;
+    double tavg_compute = t_compute / (double)r.iterations;
+    double tavg_writer  = t_writer  / (double)r.iterations;
+    double tavg_read    = t_read    / (double)r.iterations;
+    double tavg_write   = t_write   / (double)r.iterations;
+
+    std::vector<Stats> stats;
+    for (int i = 0; i < 5; ++i) stats.emplace_back(r.samples[i]);
+
+    auto stat_row = [&](const char * label, double Stats::* field) {
+        out << "│ " << label << " (ms) │ ";
+        for (int i = 0; i < 5; ++i) {
+            out << std::setw(10) << stats[i].*field * 1.0e-6 << (i < 4 ? " │ " : " │\n");
+        }
+    };
+
+    out << std::right << std::fixed  << std::setprecision(4)
+         << "Setup time Host (ms): " << std::setw(10) << r.t_setup * 1.0e-6 << "\n"
+         << "Total time Host (ms): " << std::setw(10) << r.t_host * 1.0e-6 << "\n"
+         << "Throughput Host (GB/s): " << std::setw(8) << r.host_bandwidth() << "\n"
+         << "Compute (GFLOP/s): " << std::setw(13);
+    // Autorun kernels are not timed by events, so there is no compute time
+    if (t_compute > 0) out << r.gflops() << "\n";
+    else out << "-\n";
+    out
+         << "┌──────────────────┬────────────┬────────────┬────────────┬────────────┬────────────┐\n"
+         << "│                  │   reader   │  compute   │   writer   │    read    │   write    │\n"
+         << "├──────────────────┼────────────┼────────────┼────────────┼────────────┼────────────┤\n"
+         << "│  Total Time (ms) │ " << std::setw(10) << t_reader     * 1.0e-6 << " │ "
+                                    << std::setw(10) << t_compute    * 1.0e-6 << " │ "
+                                    << std::setw(10) << t_writer     * 1.0e-6 << " │ "
+                                    << std::setw(10) << t_read       * 1.0e-6 << " │ "
+                                    << std::setw(10) << t_write      * 1.0e-6 << " │\n"
+         << "│    Avg Time (ms) │ " << std::setw(10) << tavg_reader  * 1.0e-6 << " │ "
+                                    << std::setw(10) << tavg_compute * 1.0e-6 << " │ "
+                                    << std::setw(10) << tavg_writer  * 1.0e-6 << " │ "
+                                    << std::setw(10) << tavg_read    * 1.0e-6 << " │ "
+                                    << std::setw(10) << tavg_write   * 1.0e-6 << " │\n";
+    stat_row("   Min Time", &Stats::min);
+    stat_row("Median Time", &Stats::median);
+    stat_row("   P95 Time", &Stats::p95);
+    stat_row("   P99 Time", &Stats::p99);
+    stat_row("   Max Time", &Stats::max);
+    stat_row("Stddev Time", &Stats::stddev);
+    out
+         << "│ Bandwidth (GB/s) │ " << std::setw(10) << r.bandwidth(0)         << " │ "
+                                    << std::setw(10) << r.bandwidth(1)         << " │ "
+                                    << std::setw(10) << r.bandwidth(2)         << " │ "
+                                    << std::setw(10) << r.bandwidth(3)         << " │ "
+                                    << std::setw(10) << r.bandwidth(4)         << " │\n"
+         << "└──────────────────┴────────────┴────────────┴────────────┴────────────┴────────────┘\n";
+    if (r.check.checked > 0) r.check.print(out);
+    out << "\n";
+}
+
+// Timings of the launches of an empty kernel, all in nanoseconds
+struct LaunchResults
+{
+    int launches;
+    bool set_args;
+    // Launches waited one at a time:
+    // 0 queued->submit, 1 submit->start, 2 start->end
+    std::vector<cl_ulong> gaps[3];
+    // Launches back to back: end of a launch -> start of the next one
+    std::vector<cl_ulong> idle;
+    cl_ulong t_serial;
+    cl_ulong t_burst;
+    cl_ulong t_device_burst;
+
+    LaunchResults(int launches, bool set_args)
+    : launches(launches)
+    , set_args(set_args)
+    , t_serial(0)
+    , t_burst(0)
+    , t_device_burst(0)
+    {}
+};
+
+void print_launch(const LaunchResults & r)
+{
+    std::vector<Stats> stats;
+    for (int i = 0; i < 3; ++i) stats.emplace_back(r.gaps[i]);
+    stats.emplace_back(r.idle);
+
+    auto stat_row = [&](const char * label, double Stats::* field) {
+        std::cout << "│ " << label << " (us) │ ";
+        for (int i = 0; i < 4; ++i) {
+            std::cout << std::setw(12) << stats[i].*field * 1.0e-3 << (i < 3 ? " │ " : " │\n");
+        }
+    };
+
+    std::cout << std::right << std::fixed << std::setprecision(3)
+         << "Launches: " << r.launches
+         << (r.set_args ? ", arguments set before every launch" : ", arguments set once") << "\n"
+         << "┌──────────────────┬──────────────┬──────────────┬──────────────┬──────────────┐\n"
+         << "│                  │ queue→submit │ submit→start │  start→end   │  end→start   │\n"
+         << "├──────────────────┼──────────────┼──────────────┼──────────────┼──────────────┤\n";
+    stat_row("   Min Time", &Stats::min);
+    stat_row("Median Time", &Stats::median);
+    stat_row("  Mean Time", &Stats::mean);
+    stat_row("   P99 Time", &Stats::p99);
+    stat_row("   Max Time", &Stats::max);
+    std::cout
+         << "└──────────────────┴──────────────┴──────────────┴──────────────┴──────────────┘\n"
+         << std::setprecision(1)
+         << "Serialized launches/s (Host): " << std::setw(12) << r.launches / (r.t_serial * 1.0e-9) << "\n"
+         << "Back-to-back launches/s (Host): " << std::setw(10) << r.launches / (r.t_burst * 1.0e-9) << "\n"
+         << "Back-to-back launches/s (Device): " << std::setw(8)
+         << (r.launches - 1) / (r.t_device_burst * 1.0e-9) << "\n\n";
+}
+
+// Per-chunk timings of a persistent stream, all in nanoseconds
+struct StreamResults
+{
+    int chunks;
+    int chunk;
+    int slots;
+    cl_ulong t_host;
+    // From the publication of a chunk to the host seeing it completed
+    std::vector<cl_ulong> latency;
+    CheckReport check;
+
+    StreamResults(int chunks, int chunk, int slots)
+    : chunks(chunks)
+    , chunk(chunk)
+    , slots(slots)
+    , t_host(0)
+    {}
+};
+
+void print_stream(const StreamResults & r)
+{
+    const Stats stats(r.latency);
+
+    auto stat_row = [&](const char * label, double Stats::* field) {
+        std::cout << "│ " << label << " (us) │ " << std::setw(12) << stats.*field * 1.0e-3 << " │\n";
+    };
+
+    std::cout << std::right << std::fixed << std::setprecision(3)
+         << "Chunks: " << r.chunks << " of " << r.chunk << " items, ring of " << r.slots << " slots\n"
+         << "Total time Host (ms): " << std::setw(10) << r.t_host * 1.0e-6 << "\n"
+         << "Throughput Host (GB/s): " << std::setw(8)
+         << size_t(r.chunks) * r.chunk * sizeof(float) / (double)r.t_host << "\n"
+         << "Chunks/s Host: " << std::setw(17) << r.chunks / (r.t_host * 1.0e-9) << "\n"
+         << "┌──────────────────┬──────────────┐\n"
+         << "│                  │   latency    │\n"
+         << "├──────────────────┼──────────────┤\n";
+    stat_row("   Min Time", &Stats::min);
+    stat_row("Median Time", &Stats::median);
+    stat_row("  Mean Time", &Stats::mean);
+    stat_row("   P95 Time", &Stats::p95);
+    stat_row("   P99 Time", &Stats::p99);
+    stat_row("   Max Time", &Stats::max);
+    std::cout << "└──────────────────┴──────────────┘\n";
+    if (r.check.checked > 0) r.check.print();
+    std::cout << "\n";
+}
+
+// Scaling of the Autorun pipeline with its compute units, one row per unit
+// count: the writer bandwidth is the throughput of the pipeline, compared with
+// the fewest units. An efficiency that drops while the reader stays flat means
+// the bottleneck moved to the reader.
+void print_scaling(const std::string & name, const std::vector<int> & units, const std::vector<Results> & points)
+{
+    std::cout << "Scaling: " << name << "\n"
+         << "┌────────────┬────────────┬────────────┬────────────┬────────────┬────────────┐\n"
+         << "│   units    │   reader   │   writer   │ Host(GB/s) │  speedup   │ efficiency │\n"
+         << "├────────────┼────────────┼────────────┼────────────┼────────────┼────────────┤\n";
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto & r = points[i];
+        const double speedup = r.bandwidth(2) / points[0].bandwidth(2);
+        const double ideal = units[i] / (double)units[0];
+        std::cout << std::right << std::fixed << std::setprecision(4)
+             << "│ " << std::setw(10) << units[i]              << " │ "
+                      << std::setw(10) << r.bandwidth(0)         << " │ "
+                      << std::setw(10) << r.bandwidth(2)         << " │ "
+                      << std::setw(10) << r.host_bandwidth()     << " │ "
+                      << std::setw(10) << speedup                << " │ "
+                      << std::setw(9) << std::setprecision(1) << 100.0 * speedup / ideal << "% │\n";
+    }
+    std::cout << "└────────────┴────────────┴────────────┴────────────┴────────────┴────────────┘\n\n";
+}
+
+// Launch styles of the same sequential copy, one row per configuration: the
+// kernels of each iteration, from the first start to the last end, are
+// compared with the first row, the single-task pipeline when it was run.
+void print_styles(const std::string & name, const std::vector<std::string> & names, const std::vector<Results> & points)
+{
+    std::cout << "Launch styles: " << name << "\n"
+         << "┌────────────┬────────────┬────────────┬─────────────────────────\n"
+         << "│  kernels   │ Host(GB/s) │  relative  │ configuration\n"
+         << "├────────────┼────────────┼────────────┼─────────────────────────\n";
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto & r = points[i];
+        std::cout << std::right << std::fixed << std::setprecision(4)
+             << "│ " << std::setw(10) << r.kernels_bandwidth()                                << " │ "
+                      << std::setw(10) << r.host_bandwidth()                                   << " │ "
+                      << std::setw(10) << r.kernels_bandwidth() / points[0].kernels_bandwidth() << " │ "
+                      << names[i] << "\n";
+    }
+    std::cout << "└────────────┴────────────┴────────────┴─────────────────────────\n\n";
+}
+
+// Transfer timings of the full-duplex benchmark, all in nanoseconds
+struct DuplexResults
+{
+    int iterations;
+    size_t size;
+    // 0 write alone, 1 read alone, 2 write in duplex, 3 read in duplex
+    std::vector<cl_ulong> transfers[4];
+    // From the first start to the last end of each duplex pair
+    std::vector<cl_ulong> span;
+    // Time both transfers of a duplex pair were running together
+    std::vector<cl_ulong> overlap;
+
+    DuplexResults(int iterations, size_t size)
+    : iterations(iterations)
+    , size(size)
+    {}
+};
+
+void print_duplex(const DuplexResults & r)
+{
+    const double bytes = r.size * sizeof(float);
+    double mean[4];
+    for (int i = 0; i < 4; ++i) mean[i] = Stats(r.transfers[i]).mean;
+    const double span = Stats(r.span).mean;
+    const double overlap = Stats(r.overlap).mean;
+
+    // One way after the other when alone, at the same time in duplex
+    const double both_alone = 2 * bytes / (mean[0] + mean[1]);
+    const double both_duplex = 2 * bytes / span;
+
+    auto row = [](const char * label, double alone, double duplex) {
+        std::cout << "│ " << label << " (GB/s) │ " << std::setw(10) << alone << " │ "
+                  << std::setw(10) << duplex << " │\n";
+    };
+
+    std::cout << std::right << std::fixed << std::setprecision(4)
+         << "Transfers: " << r.iterations << " per direction of " << size_t(bytes) << " bytes\n"
+         << "┌──────────────────┬────────────┬────────────┐\n"
+         << "│                  │   alone    │   duplex   │\n"
+         << "├──────────────────┼────────────┼────────────┤\n";
+    row("    write", bytes / mean[0], bytes / mean[2]);
+    row("     read", bytes / mean[1], bytes / mean[3]);
+    row("     both", both_alone, both_duplex);
+    std::cout << "└──────────────────┴────────────┴────────────┘\n"
+         << std::setprecision(1)
+         << "Overlap of the duplex pairs (%): " << std::setw(6)
+         << 100.0 * overlap / std::min(mean[2], mean[3]) << "\n"
+         << "Duplex speedup over one way at a time: " << std::setprecision(2)
+         << both_duplex / both_alone << "x\n\n";
+}
+
+// Bandwidth-vs-size table of a sweep, one row per transfer size
+void print_sweep(const std::string & name, const std::vector<Results> & curve)
+{
+    std::cout << "Sweep: " << name << "\n"
+         << "┌──────────────┬────────────┬────────────┬────────────┬────────────┬────────────┬────────────┐\n"
+         << "│  Batch Bytes │ Host(GB/s) │   reader   │  compute   │   writer   │    read    │   write    │\n"
+         << "├──────────────┼────────────┼────────────┼────────────┼────────────┼────────────┼────────────┤\n";
+    for (const auto & r : curve) {
+        std::cout << std::right << std::fixed << std::setprecision(4)
+             << "│ " << std::setw(12) << r.size * r.bytes << " │ "
+                      << std::setw(10) << r.host_bandwidth()     << " │ "
+                      << std::setw(10) << r.bandwidth(0)         << " │ "
+                      << std::setw(10) << r.bandwidth(1)         << " │ "
+                      << std::setw(10) << r.bandwidth(2)         << " │ "
+                      << std::setw(10) << r.bandwidth(3)         << " │ "
+                      << std::setw(10) << r.bandwidth(4)         << " │\n";
+    }
+    std::cout << "└──────────────┴────────────┴────────────┴────────────┴────────────┴────────────┴────────────┘\n\n";
+}
+
+// Roofline points of the compute stage, one row per configuration: the stage
+// is memory bound while its GFLOP/s grow with its arithmetic intensity
+void print_roofline(const std::vector<std::string> & names, const std::vector<Results> & points)
+{
+    std::cout << "Roofline of the compute stage\n"
+         << "┌────────────┬────────────┬────────────┬────────────┬─────────────────────────\n"
+         << "│ FLOP/item  │ FLOP/byte  │   GB/s     │  GFLOP/s   │ configuration\n"
+         << "├────────────┼────────────┼────────────┼────────────┼─────────────────────────\n";
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto & r = points[i];
+        std::cout << std::right << std::fixed << std::setprecision(4)
+             << "│ " << std::setw(10) << r.flops        << " │ "
+                      << std::setw(10) << r.intensity()  << " │ "
+                      << std::setw(10) << r.bandwidth(1) << " │ "
+                      << std::setw(10) << r.gflops()     << " │ "
+                      << names[i] << "\n";
+    }
+    std::cout << "└────────────┴────────────┴────────────┴────────────┴─────────────────────────\n\n";
+}
+
+// Bandwidth of the devices run concurrently, one row per device. The aggregate
+// is the bytes of all the devices over the span from the earliest start to the
+// latest end of their timed windows, so runs that did not overlap are not
+// counted as if they did.
+void print_devices(const std::string & name, const std::vector<int> & ids, const std::vector<Results> & results)
+{
+    std::cout << std::right << std::fixed << std::setprecision(4)
+         << "Devices: " << name << "\n"
+         << "┌──────────┬────────────┬────────────┬────────────┬────────────┬────────────┐\n"
+         << "│  device  │ Host(GB/s) │   reader   │   writer   │    read    │   write    │\n"
+         << "├──────────┼────────────┼────────────┼────────────┼────────────┼────────────┤\n";
+    size_t bytes = 0;
+    cl_ulong first = results[0].t_start;
+    cl_ulong last = results[0].t_start + results[0].t_host;
+    for (size_t d = 0; d < results.size(); ++d) {
+        const auto & r = results[d];
+        bytes += r.total_bytes();
+        first = std::min(first, r.t_start);
+        last = std::max(last, r.t_start + r.t_host);
+        std::cout << "│ " << std::setw(8) << ids[d]             << " │ "
+                  << std::setw(10) << r.host_bandwidth()       << " │ "
+                  << std::setw(10) << r.bandwidth(0)           << " │ "
+                  << std::setw(10) << r.bandwidth(2)           << " │ "
+                  << std::setw(10) << r.bandwidth(3)           << " │ "
+                  << std::setw(10) << r.bandwidth(4)           << " │\n";
+    }
+    std::cout << "├──────────┼────────────┼────────────┴────────────┴────────────┴────────────┤\n"
+              << "│      all │ " << std::setw(10) << bytes / (double)(last - first)
+              << " │ " << std::setw(10) << (last - first) * 1.0e-6 << " ms, first start to last end"
+              << std::setw(11) << "" << "│\n"
+              << "└──────────┴────────────┴───────────────────────────────────────────────────┘\n\n";
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "common.hpp"
+#include "utils.hpp"
+
+// OpenCL half on the host: only its bits are stored, arithmetic goes through
+// float, which holds the exact product of two halves
+struct half
+{
+    uint16_t bits;
+};
+
+// Round to nearest even, with overflows to infinity and gradual underflow
+inline uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const int32_t exp = int32_t((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+    if (exp >= 31) return sign | 0x7c00;
+
+    if (exp <= 0) {
+        if (exp < -10) return sign;
+        mant |= 0x800000;
+        const int shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        const uint32_t rem = mant & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway or (rem == halfway and (h & 1))) ++h;
+        return sign | h;
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent
+    uint32_t h = (uint32_t(exp) << 10) | (mant >> 13);
+    const uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 or (rem == 0x1000 and (h & 1))) ++h;
+    return sign | h;
+}
+
+inline float half_to_float(uint16_t h)
+{
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t x;
+
+    if (exp == 0x1f) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        x = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        x = sign;
+    } else {
+        // Subnormal half, normal float
+        exp = 113;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            --exp;
+        }
+        x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+template <>
+inline half random_value<half>(uint32_t seed, uint32_t i)
+{
+    return {float_to_half(hash_float(seed, i))};
+}
+
+// Name of an element type and suffix of its kernels, float has the
+// original kernels without suffix
+template <typename T> struct DataType;
+
+template <> struct DataType<int8_t>
+{
+    static const char * name()   { return "int8"; }
+    static const char * suffix() { return "_char"; }
+};
+
+template <> struct DataType<int16_t>
+{
+    static const char * name()   { return "int16"; }
+    static const char * suffix() { return "_short"; }
+};
+
+template <> struct DataType<int32_t>
+{
+    static const char * name()   { return "int32"; }
+    static const char * suffix() { return "_int"; }
+};
+
+template <> struct DataType<half>
+{
+    static const char * name()   { return "half"; }
+    static const char * suffix() { return "_half"; }
+};
+
+template <> struct DataType<float>
+{
+    static const char * name()   { return "float"; }
+    static const char * suffix() { return ""; }
+};
+
+template <> struct DataType<double>
+{
+    static const char * name()   { return "double"; }
+    static const char * suffix() { return "_double"; }
+};
+
+inline size_t data_type_size(clDataType data_type)
+{
+    const size_t sizes[] = {sizeof(float), sizeof(int8_t), sizeof(int16_t),
+                            sizeof(int32_t), sizeof(half), sizeof(double)};
+    return sizes[data_type];
+}
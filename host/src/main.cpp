@@ -1,23 +1,53 @@
 #include <iostream>
 #include <iomanip>
 #include <utility>
+#include <vector>
+#include <array>
+#include <map>
 #include <stdlib.h>
-#include <math.h>
+#include <future>
+#include <atomic>
+#include <deque>
 
 #include "opencl.hpp"
 #include "common.hpp"
 #include "options.hpp"
 #include "buffers.hpp"
+#include "results.hpp"
+#include "check.hpp"
+#include "types.hpp"
+#include "cpu.hpp"
+
+#ifdef FASTFLOW
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <ff/pipeline.hpp>
+#include <ff/farm.hpp>
+using namespace ff;
+#endif
 #include "utils.hpp"
 
 using namespace std;
 
 struct OCL
 {
-    cl_platform_id platform;
-    cl_device_id device;
-    cl_context context;
-    cl_program program;
+    cl_platform_id platform = NULL;
+    cl_device_id device = NULL;
+    cl_context context = NULL;
+    cl_program program = NULL;
+
+    // Kernels and queues outlive a single benchmark: every configuration of a
+    // sweep picks them up again instead of paying their creation each time
+    std::map<std::string, cl_kernel> kernels;
+    std::vector<cl_command_queue> queues[2];
+
+    // One large buffer reserved up front; benchmarks carve sub-buffers out of
+    // it and give the space back with rewindArena() when they are done
+    cl_mem arena = NULL;
+    size_t arena_size = 0;
+    size_t arena_used = 0;
+    size_t arena_align = 1;
 
     void init(const std::string filename, int platformid = -1, int deviceid = -1) {
         platform = (platformid < 0) ? clPromptPlatform() : clSelectPlatform(platformid);
@@ -26,390 +56,2134 @@ struct OCL
         program = clCreateBuildProgramFromBinary(context, device, filename);
     }
 
-    cl_command_queue createCommandQueue() {
+    cl_command_queue createCommandQueue(bool out_of_order = false) {
         cl_int status;
-        cl_command_queue queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+        cl_command_queue_properties properties = CL_QUEUE_PROFILING_ENABLE;
+        if (out_of_order) properties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        cl_command_queue queue = clCreateCommandQueue(context, device, properties, &status);
         clCheckErrorMsg(status, "Failed to create command queue");
         return queue;
     }
 
+    // Queue `index` of the pool, created the first time it is asked for
+    cl_command_queue queue(int index, bool out_of_order = false) {
+        auto & pool = queues[out_of_order];
+        while ((int)pool.size() <= index) pool.push_back(createCommandQueue(out_of_order));
+        return pool[index];
+    }
+
+    // Room for `allocations` sub-buffers of `bytes` in total. Without enough
+    // device memory there is no arena and every buffer is allocated on its own.
+    void reserveArena(size_t bytes, size_t allocations) {
+        arena_align = std::max<size_t>(1, deviceInfo<cl_uint>(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8);
+        bytes += allocations * arena_align;
+
+        const auto max_alloc = deviceInfo<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+        if (bytes > max_alloc) return;
+
+        cl_int status;
+        arena = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &status);
+        if (status != CL_SUCCESS) {
+            arena = NULL;
+            return;
+        }
+        arena_size = bytes;
+        arena_used = 0;
+    }
+
+    // Sub-buffer of the arena, NULL when there is no arena or no room left
+    cl_mem allocate(size_t bytes, cl_mem_flags flags) {
+        const size_t offset = (arena_used + arena_align - 1) / arena_align * arena_align;
+        if (!arena || offset + bytes > arena_size) return NULL;
+
+        cl_buffer_region region = {offset, bytes};
+        cl_int status;
+        cl_mem buffer = clCreateSubBuffer(arena, flags, CL_BUFFER_CREATE_TYPE_REGION, &region, &status);
+        if (status != CL_SUCCESS) return NULL;
+        arena_used = offset + bytes;
+        return buffer;
+    }
+
+    void rewindArena() {
+        arena_used = 0;
+    }
+
+    bool svmFineGrain() {
+        const auto caps = deviceInfo<cl_device_svm_capabilities>(device, CL_DEVICE_SVM_CAPABILITIES);
+        return (caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER) != 0;
+    }
+
+    // Whether the program was built with the kernel, for the variants chosen
+    // with build knobs
+    bool hasKernel(const std::string & kernel_name) {
+        size_t bytes = 0;
+        clCheckError(clGetProgramInfo(program, CL_PROGRAM_KERNEL_NAMES, 0, NULL, &bytes));
+        std::string names(bytes, '\0');
+        clCheckError(clGetProgramInfo(program, CL_PROGRAM_KERNEL_NAMES, bytes, &names[0], NULL));
+
+        std::stringstream ss(names.c_str());
+        std::string name;
+        while (getline(ss, name, ';')) {
+            if (name == kernel_name) return true;
+        }
+        return false;
+    }
+
+    cl_kernel createKernel(const std::string & kernel_name, int vec) {
+        return (vec > 1) ? createKernel((kernel_name + K_VEC_SUFFIX + std::to_string(vec)).c_str())
+                         : createKernel(kernel_name.c_str());
+    }
+
     cl_kernel createKernel(const char * kernel_name) {
+        auto it = kernels.find(kernel_name);
+        if (it != kernels.end()) return it->second;
+
         cl_int status;
         cl_kernel kernel = clCreateKernel(program, kernel_name, &status);
         clCheckErrorMsg(status, "Failed to create kernel");
+        kernels[kernel_name] = kernel;
         return kernel;
     }
 
     void clean() {
+        for (auto & k : kernels) clReleaseKernel(k.second);
+        for (auto & pool : queues) for (auto q : pool) clReleaseCommandQueue(q);
+        if (arena) clReleaseMemObject(arena);
         if (program) clReleaseProgram(program);
         if (context) clReleaseContext(context);
     }
 };
 
-void check_computation(const float * src, const float * dst, int n)
+template <typename T>
+struct Slot
+{
+    clMemory<T> * src;
+    clMemory<T> * dst;
+    // 0-2 kernel events, 3 read event, 4 write event
+    cl_event events[5];
+    bool pending;
+    size_t iteration;
+    // Verification of the iteration, running in the background
+    future<CheckReport> check;
+};
+
+const char * mem_type_name(clMemoryType mem_type)
+{
+    const char * names[] = {"clMemBuffer", "clMemShared", "clMemSVM",
+                            "clMemHostPtr", "clMemHugePage"};
+    return names[mem_type];
+}
+
+const char * data_type_name(clDataType data_type)
+{
+    const char * names[] = {"float", "int8", "int16", "int32", "half", "double"};
+    return names[data_type];
+}
+
+// Memory types whose write() and read() enqueue commands with an event
+bool has_transfers(clMemoryType mem_type)
+{
+    return mem_type != clMemoryType::Shared;
+}
+
+// Device buffers are placed in the given memory banks (0 lets the runtime
+// interleave them). Only clMemoryType::Buffer honours the banks: the other
+// memory types live in host memory and never get a bank flag.
+template <typename T>
+void create_memory(OCL & ocl,
+                   size_t size,
+                   clMemoryType mem_type,
+                   cl_command_queue queue_src,
+                   cl_command_queue queue_dst,
+                   clMemory<T> ** src,
+                   clMemory<T> ** dst,
+                   int src_bank = 0,
+                   int dst_bank = 0,
+                   ostream & out = cout)
+{
+    const cl_mem_flags src_flags = CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY;
+    const cl_mem_flags dst_flags = CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY;
+
+    if (mem_type == clMemoryType::Buffer) {
+        const cl_mem_flags src_placed = src_flags | clBankFlags(src_bank);
+        const cl_mem_flags dst_placed = dst_flags | clBankFlags(dst_bank);
+        // Sub-buffers cannot carry a bank flag: placed buffers get their own
+        cl_mem src_mem = (src_bank == 0) ? ocl.allocate(size * sizeof(T), src_placed) : NULL;
+        cl_mem dst_mem = (dst_bank == 0) ? ocl.allocate(size * sizeof(T), dst_placed) : NULL;
+        *src = new clMemBuffer<T>(ocl.context, queue_src, size, src_placed, src_mem);
+        *dst = new clMemBuffer<T>(ocl.context, queue_dst, size, dst_placed, dst_mem);
+    } else if (mem_type == clMemoryType::HostPtr) {
+        *src = new clMemHostPtr<T>(ocl.context, queue_src, size, src_flags);
+        *dst = new clMemHostPtr<T>(ocl.context, queue_dst, size, dst_flags);
+    } else if (mem_type == clMemoryType::HugePage) {
+        auto src_huge = new clMemHugePage<T>(ocl.context, queue_src, size, src_flags);
+        auto dst_huge = new clMemHugePage<T>(ocl.context, queue_dst, size, dst_flags);
+        *src = src_huge;
+        *dst = dst_huge;
+
+        out << "src pages: " << (src_huge->hugetlb ? "hugetlbfs" : "transparent huge pages") << "\n"
+            << "dst pages: " << (dst_huge->hugetlb ? "hugetlbfs" : "transparent huge pages") << "\n";
+    } else if (mem_type == clMemoryType::SVM) {
+        const bool fine_grain = ocl.svmFineGrain();
+        *src = new clMemSVM<T>(ocl.context, queue_src, size, CL_MEM_READ_ONLY, fine_grain);
+        *dst = new clMemSVM<T>(ocl.context, queue_dst, size, CL_MEM_WRITE_ONLY, fine_grain);
+    } else { // clMemoryType::Shared
+        *src = new clMemShared<T>(ocl.context, queue_src, size, CL_MEM_READ_ONLY);
+        *dst = new clMemShared<T>(ocl.context, queue_dst, size, CL_MEM_WRITE_ONLY);
+
+        cl_event event_map[2];
+        (*src)->map(CL_MAP_WRITE, &event_map[0]);
+        (*dst)->map(CL_MAP_READ, &event_map[1]);
+
+        out << "src->map(): " << clTimeEventMS(event_map[0]) << " ms\n"
+            << "dst->map(): " << clTimeEventMS(event_map[1]) << " ms\n";
+
+        clReleaseEvent(event_map[0]);
+        clReleaseEvent(event_map[1]);
+    }
+}
+
+// Random permutation of [0, n) for gathers and scatters, so that every item is
+// still read and written exactly once
+void random_permutation(int * index, int n)
+{
+    for (int i = 0; i < n; ++i) index[i] = i;
+
+    const uint32_t seed = hash32(uint32_t(current_time_ns()));
+    for (int i = n - 1; i > 0; --i) {
+        const int j = hash32(seed + i) % (i + 1);
+        swap(index[i], index[j]);
+    }
+}
+
+// Fills the input of an iteration, either with fresh random data or with a copy
+// of one of the datasets generated before timing started
+template <typename T>
+void fill_source(T * ptr, size_t size, const vector<vector<T>> & pool, int i)
+{
+    if (pool.empty()) {
+        random_fill(ptr, size);
+    } else {
+        parallel_copy(ptr, pool[i % pool.size()].data(), size);
+    }
+}
+
+// Waits for every command of the iteration held by the slot, records its
+// timings (unless it is a warmup iteration) and starts checking its results in
+// the background. The check overlaps the iterations still in flight and is
+// collected by finish_check() before the slot is refilled.
+template <typename T>
+void retire_slot(Slot<T> & slot,
+                 const vector<int> & stages,
+                 size_t size,
+                 int warmup,
+                 clMemoryType mem_type,
+                 Results & results,
+                 bool check_results,
+                 int max_ulps,
+                 int fma = 0)
 {
-    for (int i = 0; i < n; ++i) {
-        const float v = src[i] * src[i];
-        if (fabsf(dst[i] - v) > FLT_EPSILON) {
-            cerr << "ERROR: " << v << " != " << dst[i] << endl;
-            exit(-2);
+    if (!slot.pending) return;
+
+    const bool record = (slot.iteration >= size_t(warmup));
+
+    cl_ulong first = numeric_limits<cl_ulong>::max();
+    cl_ulong last = 0;
+    for (int k : stages) {
+        clCheckError(clWaitForEvents(1, &slot.events[k]));
+        if (record) {
+            results.add_sample(k, clTimeEventNS(slot.events[k]));
+            first = min(first, clEventProfilingNS(slot.events[k], CL_PROFILING_COMMAND_START));
+            last = max(last, clEventProfilingNS(slot.events[k], CL_PROFILING_COMMAND_END));
         }
+        clReleaseEvent(slot.events[k]);
     }
+    if (record) results.t_kernels += last - first;
+
+    if (has_transfers(mem_type)) {
+        clCheckError(clWaitForEvents(2, &slot.events[3]));
+        if (record) results.add_sample(3, clTimeEventNS(slot.events[3]));
+        if (record) results.add_sample(4, clTimeEventNS(slot.events[4]));
+        clReleaseEvent(slot.events[3]);
+        clReleaseEvent(slot.events[4]);
+    }
+
+    if (check_results) {
+        slot.check = async(launch::async, check_computation<T>,
+                           slot.src->ptr, slot.dst->ptr, size,
+                           max_ulps, slot.iteration, fma);
+    }
+    slot.pending = false;
 }
 
-void print_results(int iterations, int size,
-                   uint64_t t_start,
-                   uint64_t t_end,
-                   cl_ulong t_reader,
-                   cl_ulong t_compute,
-                   cl_ulong t_writer,
-                   cl_ulong t_read,
-                   cl_ulong t_write)
-{
-    // All timings are in nanoseconds but printed in milliseconds
-    cl_ulong t_host     = (t_end - t_start);
-    double tavg_reader  = t_reader  / (double)iterations;
-    double tavg_compute = t_compute / (double)iterations;
-    double tavg_writer  = t_writer  / (double)iterations;
-    double tavg_read    = t_read    / (double)iterations;
-    double tavg_write   = t_write   / (double)iterations;
-
-    size_t total_bytes  = iterations * size * sizeof(float);
-    double bw_reader    = total_bytes / (double)t_reader;
-    double bw_compute   = total_bytes / (double)t_compute * 2;
-    double bw_writer    = total_bytes / (double)t_writer;
-    double bw_read      = total_bytes / (double)t_read;
-    double bw_write     = total_bytes / (double)t_write;
-
-    cout << right << fixed  << setprecision(4)
-         << "Total time Host (ms): " << setw(10) << t_host * 1.0e-6 << "\n"
-         << "┌──────────────────┬────────────┬────────────┬────────────┬────────────┬────────────┐\n"
-         << "│                  │   reader   │  compute   │   writer   │    read    │   write    │\n"
-         << "├──────────────────┼────────────┼────────────┼────────────┼────────────┼────────────┤\n"
-         << "│  Total Time (ms) │ " << setw(10) << t_reader     * 1.0e-6 << " │ "
-                                    << setw(10) << t_compute    * 1.0e-6 << " │ "
-                                    << setw(10) << t_writer     * 1.0e-6 << " │ "
-                                    << setw(10) << t_read       * 1.0e-6 << " │ "
-                                    << setw(10) << t_write      * 1.0e-6 << " │\n"
-         << "│    Avg Time (ms) │ " << setw(10) << tavg_reader  * 1.0e-6 << " │ "
-                                    << setw(10) << tavg_compute * 1.0e-6 << " │ "
-                                    << setw(10) << tavg_writer  * 1.0e-6 << " │ "
-                                    << setw(10) << tavg_read    * 1.0e-6 << " │ "
-                                    << setw(10) << tavg_write   * 1.0e-6 << " │\n"
-         << "│ Bandwidth (GB/s) │ " << setw(10) << bw_reader             << " │ "
-                                    << setw(10) << bw_compute            << " │ "
-                                    << setw(10) << bw_writer             << " │ "
-                                    << setw(10) << bw_read               << " │ "
-                                    << setw(10) << bw_write              << " │\n"
-         << "└──────────────────┴────────────┴────────────┴────────────┴────────────┴────────────┘\n\n";
+template <typename T>
+void finish_check(Slot<T> & slot, Results & results)
+{
+    if (slot.check.valid()) results.check.merge(slot.check.get());
+}
+
+// Enqueues a kernel after the events of wait_list. Out-of-order queues only
+// follow the event graph, so there the kernel also waits for its previous
+// launch, held in *chain, and two iterations never share the channels.
+void enqueue_kernel(cl_command_queue queue,
+                    cl_kernel kernel,
+                    const size_t * gws,
+                    const size_t * lws,
+                    vector<cl_event> wait_list,
+                    cl_event * chain,
+                    cl_event * event)
+{
+    if (chain and *chain) wait_list.push_back(*chain);
+
+    clCheckError(clEnqueueNDRangeKernel(queue, kernel,
+                                        1, NULL, gws, lws,
+                                        wait_list.size(),
+                                        wait_list.empty() ? NULL : wait_list.data(),
+                                        event));
+    if (chain) {
+        if (*chain) clReleaseEvent(*chain);
+        clRetainEvent(*event);
+        *chain = *event;
+    }
 }
 
-void benchmark(OCL & ocl,
-               int iterations,
-               int size,
-               clKernelType kernel_type,
-               clMemoryType mem_type,
-               bool check_results = false)
+// Enqueues the write, kernels and read of the iteration held by the slot, whose
+// source is already filled. A fused kernel (kernels[0] NULL) runs alone as the
+// compute stage. chain is NULL on in-order queues.
+template <typename T>
+void enqueue_iteration(Slot<T> & slot,
+                       cl_command_queue * queues,
+                       cl_kernel * kernels,
+                       const size_t * gws,
+                       const size_t * lws,
+                       clMemoryType mem_type,
+                       cl_event * chain)
 {
+    cl_event * events = slot.events;
+    const bool fused = (kernels[0] == NULL);
 
-    cout << "Benchmark with "
-         << (kernel_type == clKernelType::Task ? "clEnqueueTask()" : "clEnqueueNDRangeKernel()")
-         << " using "
-         << (mem_type == clMemoryType::Buffer ? "clMemBuffer" : "clMemShared")
-         << " memory type\n";
+    cl_uint num_wait = 0;
+    if (has_transfers(mem_type)) {
+        slot.src->write(&events[4], false);
+        num_wait = 1;
+    }
+    const vector<cl_event> write(&events[4], &events[4] + num_wait);
 
+    if (fused) {
+        slot.src->set_kernel_arg(kernels[1], 0);
+        slot.dst->set_kernel_arg(kernels[1], 1);
+    } else {
+        slot.src->set_kernel_arg(kernels[0], 0);
+        slot.dst->set_kernel_arg(kernels[2], 0);
+    }
+    slot.dst->host_release();
 
-     // Queues
-    cl_command_queue queues[3];
-    queues[0] = ocl.createCommandQueue();
-    queues[1] = ocl.createCommandQueue();
-    queues[2] = ocl.createCommandQueue();
+    if (fused) {
+        enqueue_kernel(queues[1], kernels[1], gws, lws, write,
+                       chain ? &chain[1] : NULL, &events[1]);
+    } else {
+        enqueue_kernel(queues[0], kernels[0], gws, lws, write,
+                       chain ? &chain[0] : NULL, &events[0]);
+        for (int k = 1; k < 3; ++k) {
+            enqueue_kernel(queues[k], kernels[k], gws, lws,
+                           {}, chain ? &chain[k] : NULL, &events[k]);
+        }
+    }
 
+    if (has_transfers(mem_type)) slot.dst->read(&events[3], false, 1, &events[fused ? 1 : 2]);
 
-     // Buffers
-    clMemory<float> * src;
-    clMemory<float> * dst;
+    for (int k = 0; k < 5; ++k) clFlush(queues[k]);
+    slot.pending = true;
+}
 
-    if (mem_type == clMemoryType::Buffer) {
-        src = new clMemBuffer<float>(ocl.context, queues[0], size, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY);
-        dst = new clMemBuffer<float>(ocl.context, queues[2], size, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY);
-    } else { // clMemoryType::Shared
-        src = new clMemShared<float>(ocl.context, queues[0], size, CL_MEM_READ_ONLY);
-        dst = new clMemShared<float>(ocl.context, queues[2], size, CL_MEM_WRITE_ONLY);
-        
-        cl_event event_map[2];
-        src->map(CL_MAP_WRITE, &event_map[0]);
-        dst->map(CL_MAP_READ, &event_map[1]);
+// Host synchronization point after iteration i: with a window, every slot is
+// retired once the window is full, otherwise only the oldest iteration in
+// flight, whose slot is the next one
+template <typename T>
+void synchronize(vector<Slot<T>> & slots,
+                 int i,
+                 int window,
+                 const vector<int> & stages,
+                 size_t size,
+                 int warmup,
+                 clMemoryType mem_type,
+                 Results & results,
+                 bool check_results,
+                 int max_ulps,
+                 int fma = 0)
+{
+    if (window == 0) {
+        retire_slot(slots[(i + 1) % slots.size()], stages, size, warmup, mem_type, results,
+                    check_results, max_ulps, fma);
+    } else if ((i + 1) % window == 0) {
+        for (auto & slot : slots) retire_slot(slot, stages, size, warmup, mem_type, results,
+                                              check_results, max_ulps, fma);
+    }
+}
 
-        cout << "src->map(): " << clTimeEventMS(event_map[0]) << " ms\n"
-             << "dst->map(): " << clTimeEventMS(event_map[1]) << " ms\n";
+// Creates the reader, compute and writer kernels of a pattern, kernel type and
+// vector width and sets their scalar arguments. Kernels move vec items at once,
+// so they iterate over the returned size / vec vectors. Buffer arguments are
+// set per iteration, according to the slot in use. With a work-group size there
+// is a single fused NDRange kernel, returned in kernels[1].
+template <typename T>
+cl_ulong create_kernels(OCL & ocl,
+                        size_t size,
+                        int vec,
+                        int fma,
+                        const AccessPattern & pattern,
+                        clKernelType kernel_type,
+                        cl_command_queue queue_write,
+                        cl_kernel kernels[3],
+                        clMemory<int> ** index,
+                        const SimdVariant & fused = SimdVariant{0, 0, 0})
+{
+    *index = NULL;
+    if (fused.wg > 0) {
+        kernels[0] = NULL;
+        kernels[1] = ocl.createKernel(fused.kernel_name().c_str());
+        kernels[2] = NULL;
+
+        const cl_ulong n = size;
+        clCheckError(clSetKernelArg(kernels[1], 2, sizeof(n), &n));
+        return n;
+    }
 
-        clReleaseEvent(event_map[0]);
-        clReleaseEvent(event_map[1]);
+    if (pattern.type == clAccessPattern::Blocked) {
+        kernels[0] = ocl.createKernel(K_READER_BLOCKED_NAME);
+        kernels[1] = ocl.createKernel(K_COMPUTE_BLOCKED_NAME);
+        kernels[2] = ocl.createKernel(K_WRITER_BLOCKED_NAME);
+    } else if (pattern.type == clAccessPattern::Gather) {
+        kernels[0] = ocl.createKernel(K_READER_GATHER_NAME);
+        kernels[1] = ocl.createKernel(K_COMPUTE_GATHER_NAME);
+        kernels[2] = ocl.createKernel(K_WRITER_SCATTER_NAME);
+    } else if (kernel_type == clKernelType::Task) {
+        kernels[0] = ocl.createKernel(K_READER_SINGLE_NAME + string(DataType<T>::suffix()), vec);
+        kernels[1] = ocl.createKernel(K_COMPUTE_SINGLE_NAME + string(DataType<T>::suffix()), vec);
+        kernels[2] = ocl.createKernel(K_WRITER_SINGLE_NAME + string(DataType<T>::suffix()), vec);
+    } else {
+        kernels[0] = ocl.createKernel(K_READER_RANGE_NAME + string(DataType<T>::suffix()), vec);
+        kernels[1] = ocl.createKernel(K_COMPUTE_RANGE_NAME + string(DataType<T>::suffix()), vec);
+        kernels[2] = ocl.createKernel(K_WRITER_RANGE_NAME + string(DataType<T>::suffix()), vec);
+    }
+
+    const cl_ulong n = size / vec;
+    cl_uint n_arg = 1;
+
+    // Gathers and scatters share an index buffer, written once before timing
+    if (pattern.type == clAccessPattern::Gather) {
+        const cl_mem_flags flags = CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY;
+        *index = new clMemBuffer<int>(ocl.context, queue_write, size, flags, ocl.allocate(size * sizeof(int), flags));
+        random_permutation((*index)->ptr, size);
+        (*index)->write();
+        (*index)->set_kernel_arg(kernels[0], 1);
+        (*index)->set_kernel_arg(kernels[2], 1);
+        n_arg = 2;
+    }
+
+    clCheckError(clSetKernelArg(kernels[0], n_arg, sizeof(n), &n));
+    clCheckError(clSetKernelArg(kernels[1], 0, sizeof(n), &n));
+    clCheckError(clSetKernelArg(kernels[2], n_arg, sizeof(n), &n));
+
+    // Only the sequential float compute kernels take extra multiply-adds
+    if (pattern.type == clAccessPattern::Sequential and is_same<T, float>::value) {
+        clCheckError(clSetKernelArg(kernels[1], 1, sizeof(fma), &fma));
+    }
+
+    if (pattern.type == clAccessPattern::Blocked) {
+        for (int k = 0; k < 3; k += 2) {
+            clCheckError(clSetKernelArg(kernels[k], 2, sizeof(pattern.stride), &pattern.stride));
+            clCheckError(clSetKernelArg(kernels[k], 3, sizeof(pattern.block), &pattern.block));
+        }
+    }
+
+    return n;
+}
+
+template <typename T>
+Results benchmark(OCL & ocl,
+                  int iterations,
+                  int warmup,
+                  size_t size,
+                  int inflight,
+                  int window,
+                  bool out_of_order,
+                  int pool_size,
+                  int vec,
+                  int fma,
+                  const AccessPattern & pattern,
+                  clKernelType kernel_type,
+                  const SimdVariant & variant,
+                  clMemoryType mem_type,
+                  int src_bank,
+                  int dst_bank,
+                  bool check_results = false,
+                  int max_ulps = 0,
+                  ostream & out = cout,
+                  Barrier * start = NULL)
+{
+
+    out << "Benchmark with "
+        << (kernel_type == clKernelType::Task ? "clEnqueueTask()" : "clEnqueueNDRangeKernel()")
+        << (variant.wg > 0 ? " of a fused kernel, work-group " + to_string(variant.wg) + ", SIMD "
+                           + to_string(variant.simd) + " and " + to_string(variant.cus) + " compute unit(s)," : "")
+        << " using "
+        << mem_type_name(mem_type)
+        << " memory type, " << DataType<T>::name() << " items, "
+        << pattern.name() << " access, vector width " << vec
+        << ", " << fma << " multiply-add(s) per item"
+        << " and " << inflight << " iteration(s) in flight"
+        << (window > 0 ? ", synchronized per window" : "")
+        << (out_of_order ? " on out-of-order queues" : "") << "\n";
+
+
+     // Queues: 0-2 kernels, 3 read, 4 write
+    const cl_ulong setup_start = current_time_ns();
+    cl_command_queue queues[5];
+    for (int i = 0; i < 5; ++i) queues[i] = ocl.queue(i, out_of_order);
+
+
+     // Buffers
+    vector<Slot<T>> slots(inflight);
+    for (auto & slot : slots) {
+        create_memory(ocl, size, mem_type, queues[4], queues[3], &slot.src, &slot.dst,
+                      src_bank, dst_bank, out);
+        slot.pending = false;
     }
 
 
     // Kernels
     cl_kernel kernels[3];
-    if (kernel_type == clKernelType::Task) {
-        kernels[0] = ocl.createKernel(K_READER_SINGLE_NAME);
-        kernels[1] = ocl.createKernel(K_COMPUTE_SINGLE_NAME);
-        kernels[2] = ocl.createKernel(K_WRITER_SINGLE_NAME);
-    } else {
-        kernels[0] = ocl.createKernel(K_READER_RANGE_NAME);
-        kernels[1] = ocl.createKernel(K_COMPUTE_RANGE_NAME);
-        kernels[2] = ocl.createKernel(K_WRITER_RANGE_NAME);
-    }
+    clMemory<int> * index = NULL;
+    const cl_ulong n = create_kernels<T>(ocl, size, vec, fma, pattern, kernel_type, queues[4],
+                                         kernels, &index, variant);
 
-    cl_int argi = 0;
-    clCheckError(clSetKernelArg(kernels[0], argi++, sizeof(src->buffer), &src->buffer));
-    clCheckError(clSetKernelArg(kernels[0], argi++, sizeof(size), &size));
-    argi = 0;
-    clCheckError(clSetKernelArg(kernels[1], argi++, sizeof(size), &size));
-    argi = 0;
-    clCheckError(clSetKernelArg(kernels[2], argi++, sizeof(dst->buffer), &dst->buffer));
-    clCheckError(clSetKernelArg(kernels[2], argi++, sizeof(size), &size));
+    // Fused kernels read, compute and write alone, timed as the compute stage
+    const bool fused = (kernels[0] == NULL);
+    const vector<int> stages = fused ? vector<int>{1} : vector<int>{0, 1, 2};
+    const cl_ulong t_setup = current_time_ns() - setup_start;
 
 
     // Benchmark
     size_t gws[3] = {1, 1, 1};
     size_t lws[3] = {1, 1, 1};
     if (kernel_type == clKernelType::NDRange) {
-        gws[0] = size;
-        lws[0] = 16;
+        gws[0] = n;
+        lws[0] = (variant.wg > 0) ? variant.wg : WORK_GROUP_SIZE_X;
     }
 
-    // 0-2 kernel times, 3 read time, 4 write time
-    cl_ulong timings[5] = {0, 0, 0, 0, 0};
-    cl_ulong time_start = current_time_ns();
+    vector<vector<T>> pool(pool_size, vector<T>(size));
+    for (auto & data : pool) random_fill(data.data(), size);
 
-    for (int i = 0; i < iterations; ++i) {
-        cl_event events[5];
+    Results results(iterations, size, 1 + 2 * fma, sizeof(T));
+    results.t_setup = t_setup;
+    // Devices run together start timing together
+    if (start) start->wait();
+    cl_ulong time_start = current_time_ns();
 
-        if (mem_type == clMemoryType::Buffer) {
-            random_fill(src->ptr, size);
-            src->write(&events[4]);
-        } else { // clMemoryType::Shared
-            // const uint64_t t_write_start = current_time_ns();
-            random_fill(src->ptr, size);
-            // const uint64_t t_write_end = current_time_ns();
-            // timings[4] = t_write_end - t_write_start;
+    // Last launch of each kernel, only kept for out-of-order queues
+    cl_event chain[3] = {NULL, NULL, NULL};
+
+    // The first warmup iterations are run but not recorded
+    for (int i = 0; i < warmup + iterations; ++i) {
+        Slot<T> & slot = slots[i % inflight];
+
+        // The warmup iterations still in flight must not run in the timed window
+        if (i == warmup) {
+            for (auto & other : slots) {
+                retire_slot(other, stages, size, warmup, mem_type, results,
+                            check_results, max_ulps, fma);
+                finish_check(other, results);
+            }
+            time_start = current_time_ns();
         }
 
-        for (int i = 0; i < 3; ++i) {
-            clCheckError(clEnqueueNDRangeKernel(queues[i], kernels[i],
-                                                1, NULL, gws, lws,
-                                                0, NULL, &events[i]));
-        }
+        // The slot is reused: the iteration that was using it must be verified
+        finish_check(slot, results);
 
-        if (mem_type == clMemoryType::Buffer) dst->read(&events[3]);
+        slot.src->host_acquire(CL_MAP_WRITE);
+        fill_source(slot.src->ptr, size, pool, i);
 
-        for (int i = 0; i < 3; ++i) clFinish(queues[i]);
-        for (int i = 0; i < 3; ++i) timings[i] += clTimeEventNS(events[i]);
-        for (int i = 0; i < 3; ++i) clReleaseEvent(events[i]);
+        enqueue_iteration(slot, queues, kernels, gws, lws, mem_type, out_of_order ? chain : NULL);
+        slot.iteration = i;
 
-        if (mem_type == clMemoryType::Buffer) {
-            timings[3] += clTimeEventNS(events[3]);
-            timings[4] += clTimeEventNS(events[4]);
-            clReleaseEvent(events[3]);
-            clReleaseEvent(events[4]);
-        } else { // clMemoryType::Shared
-            // uint64_t t_read_start = current_time_ns();
-            // if (check_results) check_computation(src->ptr, dst->ptr, size);
-            // uint64_t t_read_end = current_time_ns();
-            // timings[3] = t_read_end - t_read_start;
-        }
-        if (check_results) check_computation(src->ptr, dst->ptr, size);
+        synchronize(slots, i, window, stages, size, warmup, mem_type, results,
+                    check_results, max_ulps, fma);
     }
-    for (int i = 0; i < 3; ++i) clFinish(queues[i]);
+    for (auto & slot : slots) retire_slot(slot, stages, size, warmup, mem_type, results,
+                                          check_results, max_ulps, fma);
+    for (auto & slot : slots) finish_check(slot, results);
     cl_ulong time_end = current_time_ns();
+    for (auto event : chain) if (event) clReleaseEvent(event);
 
-    print_results(iterations, size, time_start, time_end,
-                  timings[0], timings[1], timings[2],
-                  timings[3], timings[4]);
+    results.t_start = time_start;
+    results.t_host = time_end - time_start;
+    print_results(results, out);
 
 
     // Releases
-    src->release();
-    dst->release();
+    for (auto & slot : slots) {
+        slot.src->release();
+        slot.dst->release();
 
-    delete src;
-    delete dst;
+        delete slot.src;
+        delete slot.dst;
+    }
+
+    if (index) {
+        index->release();
+        delete index;
+    }
+    ocl.rewindArena();
 
-    for (int i = 0; i < 3; ++i) if (kernels[i]) clReleaseKernel(kernels[i]);
-    for (int i = 0; i < 3; ++i) if (queues[i]) clReleaseCommandQueue(queues[i]);
+    return results;
 }
 
-void benchmark_autorun(OCL & ocl,
-                       int iterations,
-                       int size,
-                       clMemoryType mem_type,
-                       bool check_results = false)
+#ifdef FASTFLOW
+// Host side as a FastFlow pipeline: an ordered farm of generators fills the
+// slots, one node enqueues the transfers and kernels, one node waits for them
+// and records their timings, and a farm of verifiers checks the results and
+// gives the slots back. Host work of different iterations thus overlaps on
+// all the cores, while the device still sees the iterations in order.
+template <typename T>
+struct FFTask
 {
+    int iteration;
+    Slot<T> * slot;
+};
 
-    cout << "Benchmark with Autorun Kernel using "
-         << (mem_type == clMemoryType::Buffer ? "clMemBuffer" : "clMemShared")
-         << " memory type\n";
+// Slots free for a new iteration, the emitter blocks while all are in use
+template <typename T>
+struct SlotPool
+{
+    mutex m;
+    condition_variable cv;
+    deque<Slot<T> *> free;
+
+    Slot<T> * acquire()
+    {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this]() { return !free.empty(); });
+        Slot<T> * slot = free.front();
+        free.pop_front();
+        return slot;
+    }
 
+    void release(Slot<T> * slot)
+    {
+        {
+            lock_guard<mutex> lock(m);
+            free.push_back(slot);
+        }
+        cv.notify_one();
+    }
+};
 
-     // Queues
-    cl_command_queue queues[2];
-    queues[0] = ocl.createCommandQueue();
-    queues[1] = ocl.createCommandQueue();
+template <typename T>
+struct FFEmitter : ff_node_t<FFTask<T>>
+{
+    int total;
+    SlotPool<T> & slots;
+
+    FFEmitter(int total, SlotPool<T> & slots)
+    : total(total)
+    , slots(slots)
+    {}
+
+    FFTask<T> * svc(FFTask<T> *) override
+    {
+        for (int i = 0; i < total; ++i) this->ff_send_out(new FFTask<T>{i, slots.acquire()});
+        return this->EOS;
+    }
+};
+
+template <typename T>
+struct FFGenerator : ff_node_t<FFTask<T>>
+{
+    size_t size;
+    const vector<vector<T>> & pool;
+
+    FFGenerator(size_t size, const vector<vector<T>> & pool)
+    : size(size)
+    , pool(pool)
+    {}
+
+    FFTask<T> * svc(FFTask<T> * task) override
+    {
+        task->slot->src->host_acquire(CL_MAP_WRITE);
+        fill_source(task->slot->src->ptr, size, pool, task->iteration);
+        return task;
+    }
+};
+
+template <typename T>
+struct FFEnqueuer : ff_node_t<FFTask<T>>
+{
+    cl_command_queue * queues;
+    cl_kernel * kernels;
+    const size_t * gws;
+    const size_t * lws;
+    clMemoryType mem_type;
+    int warmup;
+    cl_ulong & time_start;
+    // Last launch of each kernel, only kept for out-of-order queues
+    cl_event * chain;
+    const atomic<int> & retired;
+
+    FFEnqueuer(cl_command_queue * queues, cl_kernel * kernels,
+               const size_t * gws, const size_t * lws,
+               clMemoryType mem_type, int warmup, cl_ulong & time_start,
+               cl_event * chain, const atomic<int> & retired)
+    : queues(queues)
+    , kernels(kernels)
+    , gws(gws)
+    , lws(lws)
+    , mem_type(mem_type)
+    , warmup(warmup)
+    , time_start(time_start)
+    , chain(chain)
+    , retired(retired)
+    {}
+
+    FFTask<T> * svc(FFTask<T> * task) override
+    {
+        // The warmup iterations leave the pipeline before the timer starts
+        if (task->iteration == warmup) {
+            while (retired.load(memory_order_acquire) < warmup) {}
+            time_start = current_time_ns();
+        }
+
+        enqueue_iteration(*task->slot, queues, kernels, gws, lws, mem_type, chain);
+        task->slot->iteration = task->iteration;
+        return task;
+    }
+};
+
+template <typename T>
+struct FFRetirer : ff_node_t<FFTask<T>>
+{
+    size_t size;
+    int warmup;
+    clMemoryType mem_type;
+    Results & results;
+    // Iterations retired so far, in order
+    atomic<int> & retired;
+
+    FFRetirer(size_t size, int warmup, clMemoryType mem_type, Results & results,
+              atomic<int> & retired)
+    : size(size)
+    , warmup(warmup)
+    , mem_type(mem_type)
+    , results(results)
+    , retired(retired)
+    {}
+
+    // The verifiers check the results
+    FFTask<T> * svc(FFTask<T> * task) override
+    {
+        retire_slot(*task->slot, {0, 1, 2}, size, warmup, mem_type, results, false, 0);
+        retired.fetch_add(1, memory_order_release);
+        return task;
+    }
+};
+
+template <typename T>
+struct FFVerifier : ff_node_t<FFTask<T>>
+{
+    size_t size;
+    bool check_results;
+    int max_ulps;
+    int fma;
+    Results & results;
+    mutex & results_mutex;
+    SlotPool<T> & slots;
+
+    FFVerifier(size_t size, bool check_results, int max_ulps, int fma,
+               Results & results, mutex & results_mutex, SlotPool<T> & slots)
+    : size(size)
+    , check_results(check_results)
+    , max_ulps(max_ulps)
+    , fma(fma)
+    , results(results)
+    , results_mutex(results_mutex)
+    , slots(slots)
+    {}
+
+    FFTask<T> * svc(FFTask<T> * task) override
+    {
+        if (check_results) {
+            const auto report = check_computation(task->slot->src->ptr, task->slot->dst->ptr, size,
+                                                  max_ulps, task->iteration, fma);
+            lock_guard<mutex> lock(results_mutex);
+            results.check.merge(report);
+        }
+        slots.release(task->slot);
+        delete task;
+        return this->GO_ON;
+    }
+};
+
+template <typename T>
+Results benchmark_ff(OCL & ocl,
+                     int iterations,
+                     int warmup,
+                     size_t size,
+                     int inflight,
+                     bool out_of_order,
+                     int workers,
+                     int pool_size,
+                     int vec,
+                     int fma,
+                     const AccessPattern & pattern,
+                     clKernelType kernel_type,
+                     clMemoryType mem_type,
+                     int src_bank,
+                     int dst_bank,
+                     bool check_results = false,
+                     int max_ulps = 0,
+                     ostream & out = cout,
+                     Barrier * start = NULL)
+{
+
+    out << "Benchmark with "
+        << (kernel_type == clKernelType::Task ? "clEnqueueTask()" : "clEnqueueNDRangeKernel()")
+        << " using "
+        << mem_type_name(mem_type)
+        << " memory type, " << DataType<T>::name() << " items, "
+        << pattern.name() << " access, vector width " << vec
+        << ", " << fma << " multiply-add(s) per item"
+        << " and " << inflight << " iteration(s) in flight"
+        << (out_of_order ? " on out-of-order queues" : "")
+        << " on a FastFlow host pipeline with " << workers << " worker(s) per farm\n";
+
+
+     // Queues: 0-2 kernels, 3 read, 4 write
+    const cl_ulong setup_start = current_time_ns();
+    cl_command_queue queues[5];
+    for (int i = 0; i < 5; ++i) queues[i] = ocl.queue(i, out_of_order);
 
 
      // Buffers
-    clMemory<float> * src;
-    clMemory<float> * dst;
+    vector<Slot<T>> slots(inflight);
+    SlotPool<T> free_slots;
+    for (auto & slot : slots) {
+        create_memory(ocl, size, mem_type, queues[4], queues[3], &slot.src, &slot.dst,
+                      src_bank, dst_bank, out);
+        slot.pending = false;
+        free_slots.free.push_back(&slot);
+    }
 
-    if (mem_type == clMemoryType::Buffer) {
-        src = new clMemBuffer<float>(ocl.context, queues[0], size, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY);
-        dst = new clMemBuffer<float>(ocl.context, queues[1], size, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY);
-    } else { // clMemoryType::Shared
-        src = new clMemShared<float>(ocl.context, queues[0], size, CL_MEM_READ_ONLY);
-        dst = new clMemShared<float>(ocl.context, queues[1], size, CL_MEM_WRITE_ONLY);
-        
-        cl_event event_map[2];
-        src->map(CL_MAP_WRITE, &event_map[0]);
-        dst->map(CL_MAP_READ, &event_map[1]);
 
-        cout << "src->map(): " << clTimeEventMS(event_map[0]) << " ms\n"
-             << "dst->map(): " << clTimeEventMS(event_map[1]) << " ms\n";
+    // Kernels
+    cl_kernel kernels[3];
+    clMemory<int> * index = NULL;
+    const cl_ulong n = create_kernels<T>(ocl, size, vec, fma, pattern, kernel_type, queues[4],
+                                         kernels, &index);
+    const cl_ulong t_setup = current_time_ns() - setup_start;
+
 
-        clReleaseEvent(event_map[0]);
-        clReleaseEvent(event_map[1]);
+    // Benchmark
+    size_t gws[3] = {1, 1, 1};
+    size_t lws[3] = {1, 1, 1};
+    if (kernel_type == clKernelType::NDRange) {
+        gws[0] = n;
+        lws[0] = WORK_GROUP_SIZE_X;
+    }
+
+    vector<vector<T>> pool(pool_size, vector<T>(size));
+    for (auto & data : pool) random_fill(data.data(), size);
+
+    Results results(iterations, size, 1 + 2 * fma, sizeof(T));
+    results.t_setup = t_setup;
+    mutex results_mutex;
+    // Devices run together start timing together
+    if (start) start->wait();
+    cl_ulong time_start = current_time_ns();
+
+    FFEmitter<T> emitter(warmup + iterations, free_slots);
+    vector<unique_ptr<ff_node>> generators;
+    vector<unique_ptr<ff_node>> verifiers;
+    for (int w = 0; w < workers; ++w) {
+        generators.push_back(unique_ptr<ff_node>(new FFGenerator<T>(size, pool)));
+        verifiers.push_back(unique_ptr<ff_node>(new FFVerifier<T>(size, check_results, max_ulps, fma,
+                                                                  results, results_mutex, free_slots)));
+    }
+    ff_OFarm<FFTask<T>> generate(move(generators));
+    cl_event chain[3] = {NULL, NULL, NULL};
+    atomic<int> retired(0);
+    FFEnqueuer<T> enqueue(queues, kernels, gws, lws, mem_type, warmup, time_start,
+                          out_of_order ? chain : NULL, retired);
+    FFRetirer<T> retire(size, warmup, mem_type, results, retired);
+    ff_Farm<FFTask<T>> verify(move(verifiers));
+    verify.remove_collector();
+
+    ff_Pipe<> pipe(emitter, generate, enqueue, retire, verify);
+    if (pipe.run_and_wait_end() < 0) {
+        cerr << "Failed to run the FastFlow pipeline" << endl;
+        exit(1);
+    }
+    cl_ulong time_end = current_time_ns();
+    for (auto event : chain) if (event) clReleaseEvent(event);
+
+    results.t_start = time_start;
+    results.t_host = time_end - time_start;
+    print_results(results, out);
+
+
+    // Releases
+    for (auto & slot : slots) {
+        slot.src->release();
+        slot.dst->release();
+
+        delete slot.src;
+        delete slot.dst;
+    }
+
+    if (index) {
+        index->release();
+        delete index;
+    }
+    ocl.rewindArena();
+
+    return results;
+}
+#endif
+
+Results benchmark_autorun(OCL & ocl,
+                          int iterations,
+                          int warmup,
+                          size_t size,
+                          int inflight,
+                          int window,
+                          bool out_of_order,
+                          int pool_size,
+                          clMemoryType mem_type,
+                          int src_bank,
+                          int dst_bank,
+                          int units,
+                          bool check_results = false,
+                          int max_ulps = 0,
+                          ostream & out = cout,
+                          Barrier * start = NULL)
+{
+
+    out << "Benchmark with Autorun Kernel"
+        << (units > 0 ? " of " + to_string(units) + " compute unit(s) fed " + to_string(AUTORUN_VEC) + " items at once" : "")
+        << " using "
+        << mem_type_name(mem_type)
+        << " memory type and " << inflight << " iteration(s) in flight"
+        << (window > 0 ? ", synchronized per window" : "")
+        << (out_of_order ? " on out-of-order queues" : "") << "\n";
+
+
+     // Queues: 0 reader, 1 writer, 3 read, 4 write
+    const cl_ulong setup_start = current_time_ns();
+    cl_command_queue queues[5];
+    for (int i = 0; i < 5; ++i) queues[i] = (i != 2) ? ocl.queue(i, out_of_order) : NULL;
+
+
+     // Buffers
+    vector<Slot<float>> slots(inflight);
+    for (auto & slot : slots) {
+        create_memory(ocl, size, mem_type, queues[4], queues[3], &slot.src, &slot.dst,
+                      src_bank, dst_bank, out);
+        slot.pending = false;
     }
 
 
     // Kernels
     cl_kernel kernels[2];
-    kernels[0] = ocl.createKernel(K_READER_AUTORUN_NAME);
-    kernels[1] = ocl.createKernel(K_WRITER_AUTORUN_NAME);
+    const string suffix = (units > 0) ? K_CU_SUFFIX + to_string(units) : "";
+    kernels[0] = ocl.createKernel((K_READER_AUTORUN_NAME + suffix).c_str());
+    kernels[1] = ocl.createKernel((K_WRITER_AUTORUN_NAME + suffix).c_str());
 
-    cl_int argi = 0;
-    clCheckError(clSetKernelArg(kernels[0], argi++, sizeof(src->buffer), &src->buffer));
-    clCheckError(clSetKernelArg(kernels[0], argi++, sizeof(size), &size));
-    argi = 0;
-    clCheckError(clSetKernelArg(kernels[1], argi++, sizeof(dst->buffer), &dst->buffer));
-    clCheckError(clSetKernelArg(kernels[1], argi++, sizeof(size), &size));
+    // Buffer arguments are set per iteration, according to the slot in use.
+    // The scalable kernels move vectors of AUTORUN_VEC items.
+    const cl_ulong n = (units > 0) ? size / AUTORUN_VEC : size;
+    clCheckError(clSetKernelArg(kernels[0], 1, sizeof(n), &n));
+    clCheckError(clSetKernelArg(kernels[1], 1, sizeof(n), &n));
+    const cl_ulong t_setup = current_time_ns() - setup_start;
 
 
     // Benchmark
     size_t gws[3] = {1, 1, 1};
     size_t lws[3] = {1, 1, 1};
 
-    // 0-2 kernel times, 3 read time, 4 write time
-    cl_ulong timings[5] = {0, 0, 0, 0, 0};
+    vector<vector<float>> pool(pool_size, vector<float>(size));
+    for (auto & data : pool) random_fill(data.data(), size);
+
+    Results results(iterations, size);
+    results.t_setup = t_setup;
+    // Devices run together start timing together
+    if (start) start->wait();
     cl_ulong time_start = current_time_ns();
 
-    for (int i = 0; i < iterations; ++i) {
-        cl_event events[5];
+    // Last launch of each kernel, only kept for out-of-order queues
+    cl_event chain[2] = {NULL, NULL};
+
+    // The first warmup iterations are run but not recorded
+    for (int i = 0; i < warmup + iterations; ++i) {
+        Slot<float> & slot = slots[i % inflight];
+        cl_event * events = slot.events;
+
+        // The warmup iterations still in flight must not run in the timed window
+        if (i == warmup) {
+            for (auto & other : slots) {
+                retire_slot(other, {0, 2}, size, warmup, mem_type, results,
+                            check_results, max_ulps);
+                finish_check(other, results);
+            }
+            time_start = current_time_ns();
+        }
 
-        if (mem_type == clMemoryType::Buffer) {
-            random_fill(src->ptr, size);
-            src->write(&events[4]);
-        } else { // clMemoryType::Shared
-            // const uint64_t t_write_start = current_time_ns();
-            random_fill(src->ptr, size);
-            // const uint64_t t_write_end = current_time_ns();
-            // timings[4] = t_write_end - t_write_start;
+        // The slot is reused: the iteration that was using it must be verified
+        finish_check(slot, results);
+
+        slot.src->host_acquire(CL_MAP_WRITE);
+        fill_source(slot.src->ptr, size, pool, i);
+
+        cl_uint num_wait = 0;
+        if (has_transfers(mem_type)) {
+            slot.src->write(&events[4], false);
+            num_wait = 1;
         }
 
+        slot.src->set_kernel_arg(kernels[0], 0);
+        slot.dst->set_kernel_arg(kernels[1], 0);
+        slot.dst->host_release();
+
         // clEnableProfilingAutorunKernels(ocl.device, ocl.program);
-        for (int i = 0; i < 2; ++i) {
-            clCheckError(clEnqueueNDRangeKernel(queues[i], kernels[i],
+        enqueue_kernel(queues[0], kernels[0], gws, lws,
+                       vector<cl_event>(&events[4], &events[4] + num_wait),
+                       out_of_order ? &chain[0] : NULL, &events[0]);
+        enqueue_kernel(queues[1], kernels[1], gws, lws,
+                       {}, out_of_order ? &chain[1] : NULL, &events[2]);
+        clWriteAutorunKernelProfilingData(ocl.device, ocl.program);
+
+
+        if (has_transfers(mem_type)) slot.dst->read(&events[3], false, 1, &events[2]);
+
+        for (int k = 0; k < 5; ++k) if (queues[k]) clFlush(queues[k]);
+        slot.pending = true;
+        slot.iteration = i;
+
+        synchronize(slots, i, window, {0, 2}, size, warmup, mem_type, results,
+                    check_results, max_ulps);
+    }
+    for (auto & slot : slots) retire_slot(slot, {0, 2}, size, warmup, mem_type, results,
+                                          check_results, max_ulps);
+    for (auto & slot : slots) finish_check(slot, results);
+    cl_ulong time_end = current_time_ns();
+    for (auto event : chain) if (event) clReleaseEvent(event);
+
+    results.t_start = time_start;
+    results.t_host = time_end - time_start;
+    print_results(results, out);
+
+
+    // Releases
+    for (auto & slot : slots) {
+        slot.src->release();
+        slot.dst->release();
+
+        delete slot.src;
+        delete slot.dst;
+    }
+    ocl.rewindArena();
+
+    return results;
+}
+
+
+// Runs one reader/compute/writer pipeline per memory bank at the same time,
+// each one on buffers placed in its own bank. The aggregate time of a stage
+// spans from its first start to its last end across all the banks.
+Results benchmark_banks(OCL & ocl,
+                        int iterations,
+                        int warmup,
+                        size_t size,
+                        int n_banks,
+                        int pool_size,
+                        bool check_results = false,
+                        int max_ulps = 0,
+                        ostream & out = cout,
+                        Barrier * start = NULL)
+{
+
+    out << "Benchmark with " << n_banks
+        << " concurrent clEnqueueTask() pipelines, one per memory bank\n";
+
+
+    // Queues, buffers and kernels of each bank: 0-2 kernels, 3 read, 4 write
+    const cl_ulong setup_start = current_time_ns();
+    vector<array<cl_command_queue, 5>> queues(n_banks);
+    vector<array<cl_kernel, 3>> kernels(n_banks);
+    vector<Slot<float>> banks(n_banks);
+    vector<Results> bank_results(n_banks, Results(iterations, size));
+
+    const cl_ulong n = size;
+    for (int b = 0; b < n_banks; ++b) {
+        for (int k = 0; k < 5; ++k) queues[b][k] = ocl.queue(b * 5 + k);
+
+        create_memory(ocl, size, clMemoryType::Buffer, queues[b][4], queues[b][3],
+                      &banks[b].src, &banks[b].dst, b + 1, b + 1, out);
+        banks[b].pending = false;
+
+        kernels[b][0] = ocl.createKernel((K_READER_BANK_NAME + to_string(b)).c_str());
+        kernels[b][1] = ocl.createKernel((K_COMPUTE_BANK_NAME + to_string(b)).c_str());
+        kernels[b][2] = ocl.createKernel((K_WRITER_BANK_NAME + to_string(b)).c_str());
+
+        banks[b].src->set_kernel_arg(kernels[b][0], 0);
+        banks[b].dst->set_kernel_arg(kernels[b][2], 0);
+        clCheckError(clSetKernelArg(kernels[b][0], 1, sizeof(n), &n));
+        clCheckError(clSetKernelArg(kernels[b][1], 0, sizeof(n), &n));
+        clCheckError(clSetKernelArg(kernels[b][2], 1, sizeof(n), &n));
+    }
+    const cl_ulong t_setup = current_time_ns() - setup_start;
+
+
+    // Benchmark
+    size_t gws[3] = {1, 1, 1};
+    size_t lws[3] = {1, 1, 1};
+
+    vector<vector<float>> pool(pool_size, vector<float>(size));
+    for (auto & data : pool) random_fill(data.data(), size);
+
+    Results results(iterations, size * n_banks);
+    results.t_setup = t_setup;
+    // Devices run together start timing together
+    if (start) start->wait();
+    cl_ulong time_start = current_time_ns();
+
+    for (int i = 0; i < warmup + iterations; ++i) {
+        for (int b = 0; b < n_banks; ++b) finish_check(banks[b], bank_results[b]);
+        if (i == warmup) time_start = current_time_ns();
+
+        for (int b = 0; b < n_banks; ++b) {
+            Slot<float> & bank = banks[b];
+            cl_event * events = bank.events;
+
+            fill_source(bank.src->ptr, size, pool, i);
+            bank.src->write(&events[4], false);
+
+            clCheckError(clEnqueueNDRangeKernel(queues[b][0], kernels[b][0],
                                                 1, NULL, gws, lws,
-                                                0, NULL, &events[i]));
+                                                1, &events[4], &events[0]));
+            for (int k = 1; k < 3; ++k) {
+                clCheckError(clEnqueueNDRangeKernel(queues[b][k], kernels[b][k],
+                                                    1, NULL, gws, lws,
+                                                    0, NULL, &events[k]));
+            }
+            bank.dst->read(&events[3], false, 1, &events[2]);
+
+            for (auto queue : queues[b]) clFlush(queue);
+            bank.pending = true;
+            bank.iteration = i;
         }
-        clWriteAutorunKernelProfilingData(ocl.device, ocl.program);
+
+        for (auto & bank : banks) clCheckError(clWaitForEvents(5, bank.events));
+        if (i >= warmup) {
+            for (int k = 0; k < 5; ++k) {
+                cl_ulong start = numeric_limits<cl_ulong>::max();
+                cl_ulong end = 0;
+                for (auto & bank : banks) {
+                    start = min(start, clEventProfilingNS(bank.events[k], CL_PROFILING_COMMAND_START));
+                    end = max(end, clEventProfilingNS(bank.events[k], CL_PROFILING_COMMAND_END));
+                }
+                results.add_sample(k, end - start);
+            }
+        }
+
+        for (int b = 0; b < n_banks; ++b) {
+            retire_slot(banks[b], {0, 1, 2}, size, warmup, clMemoryType::Buffer, bank_results[b],
+                        check_results, max_ulps);
+        }
+    }
+    for (int b = 0; b < n_banks; ++b) finish_check(banks[b], bank_results[b]);
+    cl_ulong time_end = current_time_ns();
+
+    results.t_start = time_start;
+    results.t_host = time_end - time_start;
+    for (int b = 0; b < n_banks; ++b) {
+        bank_results[b].t_host = results.t_host;
+        results.check.merge(bank_results[b].check);
+
+        out << "Bank " << b + 1 << "\n";
+        print_results(bank_results[b], out);
+    }
+    out << "Aggregate of " << n_banks << " banks\n";
+    print_results(results, out);
+
+
+    // Releases
+    for (int b = 0; b < n_banks; ++b) {
+        banks[b].src->release();
+        banks[b].dst->release();
+
+        delete banks[b].src;
+        delete banks[b].dst;
+    }
+
+    return results;
+}
+
+// Host-only reference: the same reader/compute/writer pipeline run by threads
+// joined by SPSC queues, with clEnqueueWriteBuffer and clEnqueueReadBuffer
+// mirrored by copies between host and "device" buffers.
+Results benchmark_cpu(int iterations,
+                      int warmup,
+                      size_t size,
+                      int units,
+                      int pool_size,
+                      bool check_results = false,
+                      int max_ulps = 0,
+                      ostream & out = cout,
+                      Barrier * start = NULL)
+{
+
+    out << "Benchmark with CPU threads and " << units << " compute unit(s)\n";
+
+
+     // Buffers: host side and "device" side
+    vector<float> src(size);
+    vector<float> dst(size);
+    vector<float> device_src(size);
+    vector<float> device_dst(size);
+
+
+    // Benchmark
+    vector<vector<float>> pool(pool_size, vector<float>(size));
+    for (auto & data : pool) random_fill(data.data(), size);
+
+    Results results(iterations, size);
+    // Devices run together start timing together
+    if (start) start->wait();
+    cl_ulong time_start = current_time_ns();
+
+    // The first warmup iterations are run but not recorded
+    for (int i = 0; i < warmup + iterations; ++i) {
+        if (i == warmup) time_start = current_time_ns();
+        fill_source(src.data(), size, pool, i);
+
+        StageTime times[5];
+        times[4].start = current_time_ns();
+        parallel_copy(device_src.data(), src.data(), size);
+        times[4].end = current_time_ns();
+
+        cpu_pipeline(device_src.data(), device_dst.data(), size, units, times);
+
+        times[3].start = current_time_ns();
+        parallel_copy(dst.data(), device_dst.data(), size);
+        times[3].end = current_time_ns();
+
+        if (i >= warmup) {
+            for (int k = 0; k < 5; ++k) results.add_sample(k, times[k].end - times[k].start);
+        }
+        if (check_results) {
+            results.check.merge(check_computation(src.data(), dst.data(), size, max_ulps, i));
+        }
+    }
+    cl_ulong time_end = current_time_ns();
+
+    results.t_start = time_start;
+    results.t_host = time_end - time_start;
+    print_results(results, out);
+
+    return results;
+}
+
+// Launches an empty kernel one at a time, waiting for each launch, to measure
+// the gaps between its four profiling counters, then back to back to measure
+// the launch rate. Its arguments are either set once or before every launch.
+LaunchResults benchmark_launch(OCL & ocl,
+                               int iterations,
+                               int warmup,
+                               bool set_args)
+{
+
+    cout << "Launch benchmark with clEnqueueTask() of an empty kernel, "
+         << (set_args ? "setting its arguments before every launch" : "setting its arguments once")
+         << "\n";
+
+
+    cl_command_queue queue = ocl.queue(0);
+    cl_kernel kernel = ocl.createKernel(K_LAUNCH_NAME);
+    clMemory<float> * data = new clMemBuffer<float>(ocl.context, queue, 1, CL_MEM_WRITE_ONLY);
+
+    // n = 0 keeps the kernel empty
+    const int n = 0;
+    auto set_kernel_args = [&]() {
+        data->set_kernel_arg(kernel, 0);
+        clCheckError(clSetKernelArg(kernel, 1, sizeof(n), &n));
+    };
+    auto launch = [&](cl_event * event) {
+        if (set_args) set_kernel_args();
+        size_t gws[3] = {1, 1, 1};
+        size_t lws[3] = {1, 1, 1};
+        clCheckError(clEnqueueNDRangeKernel(queue, kernel,
+                                            1, NULL, gws, lws,
+                                            0, NULL, event));
+    };
+    set_kernel_args();
+
+
+    // Benchmark
+    LaunchResults results(iterations, set_args);
+    vector<cl_event> events(iterations);
+
+    // The first warmup launches are run but not recorded
+    for (int i = 0; i < warmup; ++i) {
+        cl_event event;
+        launch(&event);
+        clCheckError(clWaitForEvents(1, &event));
+        clReleaseEvent(event);
+    }
+
+    cl_ulong time_start = current_time_ns();
+    for (int i = 0; i < iterations; ++i) {
+        launch(&events[i]);
+        clCheckError(clWaitForEvents(1, &events[i]));
+    }
+    results.t_serial = current_time_ns() - time_start;
+
+    const cl_profiling_info counters[4] = {CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT,
+                                           CL_PROFILING_COMMAND_START,  CL_PROFILING_COMMAND_END};
+    for (auto event : events) {
+        cl_ulong t[4];
+        for (int k = 0; k < 4; ++k) t[k] = clEventProfilingNS(event, counters[k]);
+        for (int k = 0; k < 3; ++k) results.gaps[k].push_back(t[k + 1] - t[k]);
+        clReleaseEvent(event);
+    }
+
+    time_start = current_time_ns();
+    for (int i = 0; i < iterations; ++i) launch(&events[i]);
+    clCheckError(clFinish(queue));
+    results.t_burst = current_time_ns() - time_start;
+
+    for (int i = 1; i < iterations; ++i) {
+        results.idle.push_back(clEventProfilingNS(events[i], CL_PROFILING_COMMAND_START) -
+                               clEventProfilingNS(events[i - 1], CL_PROFILING_COMMAND_END));
+    }
+    if (iterations > 0) {
+        results.t_device_burst = clEventProfilingNS(events.back(), CL_PROFILING_COMMAND_START) -
+                                 clEventProfilingNS(events.front(), CL_PROFILING_COMMAND_START);
+    }
+    for (auto event : events) clReleaseEvent(event);
+
+    print_launch(results);
+
+
+    // Releases
+    data->release();
+    delete data;
+
+    return results;
+}
+
+// Persistent streaming: the kernels are launched once and loop over a ring of
+// `slots` chunks in shared memory, which the host fills and publishes through
+// a doorbell while polling the completion flags written by the device. The
+// latency of a chunk goes from its publication to the host seeing it done.
+StreamResults benchmark_persistent(OCL & ocl,
+                                   int iterations,
+                                   int warmup,
+                                   int chunk,
+                                   int slots,
+                                   int pool_size,
+                                   bool check_results = false,
+                                   int max_ulps = 0)
+{
+
+    cout << "Benchmark with persistent kernels streaming a ring of " << slots
+         << " chunk(s) in clMemShared memory\n";
+
+
+     // Queues: 0-2 kernels
+    cl_command_queue queues[3];
+    for (int i = 0; i < 3; ++i) queues[i] = ocl.queue(i);
+
+
+     // Buffers
+    const int ring = chunk * slots;
+    clMemShared<float> src(ocl.context, queues[0], ring, CL_MEM_READ_ONLY);
+    clMemShared<float> dst(ocl.context, queues[2], ring, CL_MEM_WRITE_ONLY);
+    clMemShared<int> doorbell_mem(ocl.context, queues[0], slots, CL_MEM_READ_ONLY);
+    clMemShared<int> done_mem(ocl.context, queues[2], slots, CL_MEM_READ_WRITE);
+    src.map(CL_MAP_WRITE);
+    dst.map(CL_MAP_READ);
+    doorbell_mem.map(CL_MAP_WRITE);
+    done_mem.map(CL_MAP_READ | CL_MAP_WRITE);
+
+    // Both sides poll these, so every access must reach the memory
+    volatile int * doorbell = doorbell_mem.ptr;
+    volatile int * done = done_mem.ptr;
+    for (int s = 0; s < slots; ++s) {
+        doorbell[s] = -1;
+        done[s] = -1;
+    }
+
+
+    // Kernels
+    cl_kernel kernels[3];
+    kernels[0] = ocl.createKernel(K_READER_PERSISTENT_NAME);
+    kernels[1] = ocl.createKernel(K_COMPUTE_PERSISTENT_NAME);
+    kernels[2] = ocl.createKernel(K_WRITER_PERSISTENT_NAME);
+
+    src.set_kernel_arg(kernels[0], 0);
+    doorbell_mem.set_kernel_arg(kernels[0], 1);
+    clCheckError(clSetKernelArg(kernels[0], 2, sizeof(chunk), &chunk));
+    clCheckError(clSetKernelArg(kernels[0], 3, sizeof(slots), &slots));
+    clCheckError(clSetKernelArg(kernels[1], 0, sizeof(chunk), &chunk));
+    dst.set_kernel_arg(kernels[2], 0);
+    done_mem.set_kernel_arg(kernels[2], 1);
+    clCheckError(clSetKernelArg(kernels[2], 2, sizeof(chunk), &chunk));
+    clCheckError(clSetKernelArg(kernels[2], 3, sizeof(slots), &slots));
+
+
+    // Benchmark
+    size_t gws[3] = {1, 1, 1};
+    size_t lws[3] = {1, 1, 1};
+    for (int k = 0; k < 3; ++k) {
+        clCheckError(clEnqueueNDRangeKernel(queues[k], kernels[k],
+                                            1, NULL, gws, lws,
+                                            0, NULL, NULL));
+        clFlush(queues[k]);
+    }
+
+    vector<vector<float>> pool(pool_size, vector<float>(chunk));
+    for (auto & data : pool) random_fill(data.data(), chunk);
+
+    StreamResults results(iterations, chunk, slots);
+    vector<cl_ulong> published(slots);
+
+    // Waits for the chunk seq, whose slot is about to be reused
+    auto complete = [&](int seq) {
+        const int s = seq % slots;
+        while (done[s] != seq) {}
+        atomic_thread_fence(memory_order_acquire);
+
+        if (seq >= warmup) results.latency.push_back(current_time_ns() - published[s]);
+        if (check_results) {
+            results.check.merge(check_computation(src.ptr + size_t(s) * chunk,
+                                                  dst.ptr + size_t(s) * chunk,
+                                                  chunk, max_ulps, seq));
+        }
+    };
+
+    // Completes the chunks in order up to, but not including, end
+    int completed = 0;
+    auto complete_until = [&](int end) {
+        for (; completed < end; ++completed) complete(completed);
+    };
+
+    // The first warmup chunks are streamed but not recorded, and all of them
+    // complete before the timer starts
+    const int total = warmup + iterations;
+    cl_ulong time_start = current_time_ns();
+    for (int i = 0; i < total; ++i) {
+        const int s = i % slots;
+        if (i == warmup) {
+            complete_until(warmup);
+            time_start = current_time_ns();
+        }
+        if (i >= slots) complete_until(i - slots + 1);
+
+        fill_source(src.ptr + size_t(s) * chunk, chunk, pool, i);
+        atomic_thread_fence(memory_order_release);
+        published[s] = current_time_ns();
+        doorbell[s] = i;
+    }
+    complete_until(total);
+    cl_ulong time_end = current_time_ns();
+
+    doorbell[total % slots] = STREAM_STOP;
+    for (int k = 0; k < 3; ++k) clCheckError(clFinish(queues[k]));
+
+    results.t_host = time_end - time_start;
+    print_stream(results);
+
+
+    // Releases
+    src.release();
+    dst.release();
+    doorbell_mem.release();
+    done_mem.release();
+
+    return results;
+}
+
+// Out-of-core streaming: a host dataset larger than the device memory goes
+// through a ring of `slots` clMemBuffer pairs one chunk at a time. Transfers
+// move straight between the dataset and the device buffers, so with three or
+// more slots the write of chunk k overlaps the kernels of chunk k-1 and the
+// read of chunk k-2. Every iteration streams the whole dataset. The dataset
+// is random unless it is mapped from an input file, and the results are
+// dropped unless they are mapped to an output file, synced before the timer
+// stops so that disk to device to disk is measured.
+Results benchmark_chunked(OCL & ocl,
+                          int iterations,
+                          int warmup,
+                          size_t dataset,
+                          size_t chunk,
+                          int slots,
+                          const string & input,
+                          const string & output,
+                          bool check_results = false,
+                          int max_ulps = 0)
+{
+    const size_t n_chunks = dataset / chunk;
+    dataset = n_chunks * chunk;
+    const size_t chunk_bytes = size_t(chunk) * sizeof(float);
+
+    cout << "Benchmark with clEnqueueTask() streaming a dataset of " << dataset << " items in "
+         << n_chunks << " chunk(s) through " << slots << " clMemBuffer slot(s)"
+         << (input.empty() ? "" : ", read from " + input)
+         << (output.empty() ? "" : ", written to " + output) << "\n";
+
+
+     // Queues: 0-2 kernels, 3 read, 4 write
+    const cl_ulong setup_start = current_time_ns();
+    cl_command_queue queues[5];
+    for (int i = 0; i < 5; ++i) queues[i] = ocl.queue(i);
+
+
+     // Buffers: the dataset on the host, a ring of chunks on the device
+    float * src_data = NULL;
+    float * dst_data = NULL;
+    MappedFile * src_file = input.empty() ? NULL : new MappedFile(input, false);
+    MappedFile * dst_file = output.empty() ? NULL : new MappedFile(output, true, dataset * sizeof(float));
+    if (src_file) src_data = (float *)src_file->ptr;
+    else if (posix_memalign((void**)&src_data, AOCL_ALIGNMENT, dataset * sizeof(float)) != 0) {
+        clCheckErrorMsg(-255, "Failed to allocate the host dataset");
+    }
+    if (dst_file) dst_data = (float *)dst_file->ptr;
+    else if (posix_memalign((void**)&dst_data, AOCL_ALIGNMENT, dataset * sizeof(float)) != 0) {
+        clCheckErrorMsg(-255, "Failed to allocate the host dataset");
+    }
+
+    vector<Slot<float>> ring(slots);
+    for (auto & slot : ring) {
+        create_memory(ocl, chunk, clMemoryType::Buffer, queues[4], queues[3], &slot.src, &slot.dst);
+        slot.pending = false;
+    }
 
 
-        if (mem_type == clMemoryType::Buffer) dst->read(&events[3]);
+    // Kernels
+    cl_kernel kernels[3];
+    clMemory<int> * index = NULL;
+    create_kernels<float>(ocl, chunk, 1, 0, AccessPattern{clAccessPattern::Sequential, 1, 1},
+                          clKernelType::Task, queues[4], kernels, &index);
+    const cl_ulong t_setup = current_time_ns() - setup_start;
 
-        for (int i = 0; i < 2; ++i) clFinish(queues[i]);
-        for (int i = 0; i < 2; ++i) timings[i] += clTimeEventNS(events[i]);
-        for (int i = 0; i < 2; ++i) clReleaseEvent(events[i]);
 
-        if (mem_type == clMemoryType::Buffer) {
-            timings[3] += clTimeEventNS(events[3]);
-            timings[4] += clTimeEventNS(events[4]);
-            clReleaseEvent(events[3]);
-            clReleaseEvent(events[4]);
-        } else { // clMemoryType::Shared
-            // uint64_t t_read_start = current_time_ns();
-            // if (check_results) check_computation(src->ptr, dst->ptr, size);
-            // uint64_t t_read_end = current_time_ns();
-            // timings[3] = t_read_end - t_read_start;
+    // Benchmark
+    size_t gws[3] = {1, 1, 1};
+    size_t lws[3] = {1, 1, 1};
+
+    if (!src_file) {
+        for (size_t c = 0; c < n_chunks; ++c) random_fill(src_data + c * chunk, chunk);
+    }
+
+    Results results(size_t(iterations) * n_chunks, chunk);
+    results.t_setup = t_setup;
+
+    // Checks of the chunks read back, oldest first. A check runs in the
+    // background until the host copy of its chunk is about to be overwritten,
+    // a whole pass later, or until as many checks as slots are running.
+    deque<pair<size_t, future<CheckReport>>> checks;
+    auto collect = [&](size_t seq, bool all) {
+        while (!checks.empty() and (all or checks.size() >= size_t(slots) or
+                                    checks.front().first + n_chunks <= seq)) {
+            results.check.merge(checks.front().second.get());
+            checks.pop_front();
         }
-        if (check_results) check_computation(src->ptr, dst->ptr, size);
+    };
+
+    // Waits for the chunk held by the slot and starts its check
+    auto retire = [&](Slot<float> & slot) {
+        if (!slot.pending) return;
+        const size_t seq = slot.iteration;
+        const size_t c = seq % n_chunks;
+        const bool record = (seq / n_chunks >= size_t(warmup));
+
+        clCheckError(clWaitForEvents(5, slot.events));
+        for (int k = 0; k < 5; ++k) {
+            if (record) results.add_sample(k, clTimeEventNS(slot.events[k]));
+            clReleaseEvent(slot.events[k]);
+        }
+        if (check_results) {
+            checks.emplace_back(seq, async(launch::async, check_computation<float>,
+                                           src_data + c * chunk, dst_data + c * chunk, chunk,
+                                           max_ulps, c, 0));
+        }
+        slot.pending = false;
+    };
+
+    // The first warmup passes over the dataset are run but not recorded
+    const size_t total = size_t(warmup + iterations) * n_chunks;
+    cl_ulong time_start = current_time_ns();
+    for (size_t i = 0; i < total; ++i) {
+        Slot<float> & slot = ring[i % slots];
+        cl_event * events = slot.events;
+        const size_t c = i % n_chunks;
+
+        // The warmup chunks still in flight must not run in the timed window
+        if (i == size_t(warmup) * n_chunks) {
+            for (auto & other : ring) retire(other);
+            collect(i, true);
+            time_start = current_time_ns();
+        }
+        retire(slot);
+        collect(i, false);
+
+        clCheckError(clEnqueueWriteBuffer(queues[4], slot.src->buffer, CL_FALSE, 0, chunk_bytes,
+                                          src_data + c * chunk, 0, NULL, &events[4]));
+
+        slot.src->set_kernel_arg(kernels[0], 0);
+        slot.dst->set_kernel_arg(kernels[2], 0);
+
+        enqueue_kernel(queues[0], kernels[0], gws, lws, {events[4]}, NULL, &events[0]);
+        for (int k = 1; k < 3; ++k) enqueue_kernel(queues[k], kernels[k], gws, lws, {}, NULL, &events[k]);
+
+        clCheckError(clEnqueueReadBuffer(queues[3], slot.dst->buffer, CL_FALSE, 0, chunk_bytes,
+                                         dst_data + c * chunk, 1, &events[2], &events[3]));
+
+        for (int k = 0; k < 5; ++k) clFlush(queues[k]);
+        slot.pending = true;
+        slot.iteration = i;
     }
-    for (int i = 0; i < 2; ++i) clFinish(queues[i]);
+    for (auto & slot : ring) retire(slot);
+    collect(total, true);
+    if (dst_file) dst_file->sync();
     cl_ulong time_end = current_time_ns();
 
-    print_results(iterations, size, time_start, time_end,
-                  timings[0], 0, timings[1],
-                  timings[3], timings[4]);
+    results.t_host = time_end - time_start;
+    cout << fixed << setprecision(3)
+         << "Dataset (MB): " << setw(18) << dataset * sizeof(float) / (double)(1 << 20) << "\n";
+    print_results(results);
 
 
     // Releases
-    src->release();
-    dst->release();
+    for (auto & slot : ring) {
+        slot.src->release();
+        slot.dst->release();
 
-    delete src;
-    delete dst;
+        delete slot.src;
+        delete slot.dst;
+    }
+    for (auto file : {src_file, dst_file}) {
+        if (file) file->release();
+        delete file;
+    }
+    if (!src_file) free(src_data);
+    if (!dst_file) free(dst_data);
+    ocl.rewindArena();
 
-    for (int i = 0; i < 2; ++i) if (kernels[i]) clReleaseKernel(kernels[i]);
-    for (int i = 0; i < 2; ++i) if (queues[i]) clReleaseCommandQueue(queues[i]);
+    return results;
 }
 
+// Full duplex: host to device writes and device to host reads on their own
+// queues, first one direction at a time, then the write of chunk k+1 together
+// with the read of chunk k, to see whether both directions of the link and of
+// the DMA engines move data at the same time
+DuplexResults benchmark_duplex(OCL & ocl,
+                               int iterations,
+                               int warmup,
+                               size_t size)
+{
+
+    cout << "Benchmark with clEnqueueWriteBuffer() and clEnqueueReadBuffer() in full duplex\n";
+
+
+     // Queues: 3 read, 4 write
+    cl_command_queue queue_read = ocl.queue(3);
+    cl_command_queue queue_write = ocl.queue(4);
+
+
+     // Buffers: chunks k and k+1
+    Slot<float> slots[2];
+    for (auto & slot : slots) {
+        create_memory(ocl, size, clMemoryType::Buffer, queue_write, queue_read, &slot.src, &slot.dst);
+        random_fill(slot.src->ptr, size);
+        slot.src->write();
+        slot.dst->read();
+    }
+
+
+    // Benchmark
+    DuplexResults results(iterations, size);
+
+    // One direction at a time
+    for (int i = 0; i < warmup + iterations; ++i) {
+        cl_event event;
+        slots[i % 2].src->write(&event, false);
+        clCheckError(clWaitForEvents(1, &event));
+        if (i >= warmup) results.transfers[0].push_back(clTimeEventNS(event));
+        clReleaseEvent(event);
+    }
+    for (int i = 0; i < warmup + iterations; ++i) {
+        cl_event event;
+        slots[i % 2].dst->read(&event, false);
+        clCheckError(clWaitForEvents(1, &event));
+        if (i >= warmup) results.transfers[1].push_back(clTimeEventNS(event));
+        clReleaseEvent(event);
+    }
+
+    // Both directions at the same time
+    for (int i = 0; i < warmup + iterations; ++i) {
+        cl_event events[2];
+        slots[(i + 1) % 2].src->write(&events[0], false);
+        slots[i % 2].dst->read(&events[1], false);
+        clFlush(queue_write);
+        clFlush(queue_read);
+        clCheckError(clWaitForEvents(2, events));
+
+        if (i >= warmup) {
+            cl_ulong start[2], end[2];
+            for (int k = 0; k < 2; ++k) {
+                start[k] = clEventProfilingNS(events[k], CL_PROFILING_COMMAND_START);
+                end[k] = clEventProfilingNS(events[k], CL_PROFILING_COMMAND_END);
+                results.transfers[2 + k].push_back(end[k] - start[k]);
+            }
+            const cl_ulong first = min(start[0], start[1]);
+            const cl_ulong last = max(end[0], end[1]);
+            const cl_ulong together_start = max(start[0], start[1]);
+            const cl_ulong together_end = min(end[0], end[1]);
+            results.span.push_back(last - first);
+            results.overlap.push_back(together_end > together_start ? together_end - together_start : 0);
+        }
+        for (auto event : events) clReleaseEvent(event);
+    }
+
+    print_duplex(results);
+
+
+    // Releases
+    for (auto & slot : slots) {
+        slot.src->release();
+        slot.dst->release();
+
+        delete slot.src;
+        delete slot.dst;
+    }
+    ocl.rewindArena();
+
+    return results;
+}
+
+// Kernel and memory combination benchmarked for every size
+struct Config
+{
+    clKernelType kernel_type;
+    clMemoryType mem_type;
+    int vec;
+    AccessPattern pattern;
+    int fma;
+    clDataType data_type;
+    // Compute units of the scalable Autorun kernels, 0 for the fixed ones
+    int units;
+    // Fused NDRange kernel, a work-group size of 0 for the reader, compute
+    // and writer ones
+    SimdVariant fused;
+
+    string name() const
+    {
+        const char * kernel_names[] = {"Task", "NDRange", "Autorun", "MultiBank", "CPU"};
+        return string(kernel_names[kernel_type]) + " / " + mem_type_name(mem_type)
+             + " / " + pattern.name() + " / vector width " + to_string(vec)
+             + (fma > 0 ? " / " + to_string(fma) + " multiply-adds" : "")
+             + (data_type != clDataType::Float ? string(" / ") + data_type_name(data_type) : "")
+             + (units > 0 ? " / " + to_string(units) + " compute units" : "")
+             + (fused.wg > 0 ? " / fused, work-group " + to_string(fused.wg) + " x SIMD " + to_string(fused.simd)
+                               + " x " + to_string(fused.cus) + " compute unit(s)" : "");
+    }
+};
+
+vector<Config> configurations(const Options & opt)
+{
+    vector<Config> configs;
+    vector<clMemoryType> mem_types;
+    if (opt.buffer)   mem_types.push_back(clMemoryType::Buffer);
+    if (opt.shared)   mem_types.push_back(clMemoryType::Shared);
+    if (opt.svm)      mem_types.push_back(clMemoryType::SVM);
+    if (opt.hostptr)  mem_types.push_back(clMemoryType::HostPtr);
+    if (opt.hugepage) mem_types.push_back(clMemoryType::HugePage);
+
+    // Only the sequential access has vector, NDRange and Autorun variants
+    for (const auto & pattern : opt.patterns) {
+        if (pattern.type != clAccessPattern::Sequential) {
+            for (auto mem_type : mem_types) {
+                if (opt.task) configs.push_back({clKernelType::Task, mem_type, 1, pattern, 0,
+                                                 clDataType::Float, 0, {0, 0, 0}});
+            }
+            continue;
+        }
+
+        // Other element types only have scalar Task and NDRange variants
+        for (auto data_type : opt.data_types) {
+            const bool is_float = (data_type == clDataType::Float);
+            for (int fma : is_float ? opt.fmas : vector<int>(1, 0)) {
+                for (int vec : is_float ? opt.vec_widths : vector<int>(1, 1)) {
+                    for (auto mem_type : mem_types) {
+                        if (opt.task)  configs.push_back({clKernelType::Task, mem_type, vec, pattern, fma,
+                                                          data_type, 0, {0, 0, 0}});
+                    }
+                    for (auto mem_type : mem_types) {
+                        if (opt.range) configs.push_back({clKernelType::NDRange, mem_type, vec, pattern, fma,
+                                                          data_type, 0, {0, 0, 0}});
+                    }
+                }
+            }
+        }
+        for (auto mem_type : mem_types) {
+            if (opt.autorun) configs.push_back({clKernelType::Autorun, mem_type, 1, pattern, 0,
+                                                clDataType::Float, 0, {0, 0, 0}});
+            for (int units : opt.autorun_units) {
+                configs.push_back({clKernelType::Autorun, mem_type, AUTORUN_VEC, pattern, 0,
+                                   clDataType::Float, units, {0, 0, 0}});
+            }
+            for (const auto & variant : opt.simd_variants) {
+                configs.push_back({clKernelType::NDRange, mem_type, 1, pattern, 0,
+                                   clDataType::Float, 0, variant});
+            }
+        }
+    }
+
+    // Per-bank pipelines always place clMemBuffer buffers in their bank
+    if (opt.banks > 0) {
+        configs.push_back({clKernelType::MultiBank, clMemoryType::Buffer, 1, {clAccessPattern::Sequential, 1, 1}, 0,
+                           clDataType::Float, 0, {0, 0, 0}});
+    }
+
+    // The CPU reference has no memory types of its own
+    if (opt.cpu > 0) {
+        configs.push_back({clKernelType::CPU, clMemoryType::Buffer, 1, {clAccessPattern::Sequential, 1, 1}, 0,
+                           clDataType::Float, 0, {0, 0, 0}});
+    }
+    return configs;
+}
+
+template <typename T>
+Results run_typed(OCL & ocl, const Options & opt, const Config & config, size_t size,
+                  ostream & out, Barrier * start)
+{
+#ifdef FASTFLOW
+    // The FastFlow pipeline drives the reader, compute and writer kernels only
+    if (opt.fastflow > 0 and config.fused.wg == 0) {
+        return benchmark_ff<T>(ocl, opt.iterations, opt.warmup, size,
+                               opt.inflight, opt.out_of_order, opt.fastflow, opt.pool,
+                               config.vec, config.fma, config.pattern,
+                               config.kernel_type, config.mem_type, opt.src_bank, opt.dst_bank,
+                               opt.check_results, opt.max_ulps, out, start);
+    }
+#endif
+    return benchmark<T>(ocl, opt.iterations, opt.warmup, size,
+                        opt.inflight, opt.window, opt.out_of_order, opt.pool,
+                        config.vec, config.fma, config.pattern,
+                        config.kernel_type, config.fused,
+                        config.mem_type, opt.src_bank, opt.dst_bank,
+                        opt.check_results, opt.max_ulps, out, start);
+}
+
+Results run(OCL & ocl, const Options & opt, const Config & config, size_t size,
+            ostream & out = cout, Barrier * start = NULL)
+{
+    if (config.kernel_type == clKernelType::CPU) {
+        return benchmark_cpu(opt.iterations, opt.warmup, size,
+                             opt.cpu, opt.pool,
+                             opt.check_results, opt.max_ulps, out, start);
+    }
+    if (config.kernel_type == clKernelType::MultiBank) {
+        return benchmark_banks(ocl, opt.iterations, opt.warmup, size,
+                               opt.banks, opt.pool,
+                               opt.check_results, opt.max_ulps, out, start);
+    }
+    if (config.kernel_type == clKernelType::Autorun) {
+        return benchmark_autorun(ocl, opt.iterations, opt.warmup, size,
+                                 opt.inflight, opt.window, opt.out_of_order, opt.pool,
+                                 config.mem_type, opt.src_bank, opt.dst_bank, config.units,
+                                 opt.check_results, opt.max_ulps, out, start);
+    }
+    switch (config.data_type) {
+        case clDataType::Int8:   return run_typed<int8_t>(ocl, opt, config, size, out, start);
+        case clDataType::Int16:  return run_typed<int16_t>(ocl, opt, config, size, out, start);
+        case clDataType::Int32:  return run_typed<int32_t>(ocl, opt, config, size, out, start);
+        case clDataType::Half:   return run_typed<half>(ocl, opt, config, size, out, start);
+        case clDataType::Double: return run_typed<double>(ocl, opt, config, size, out, start);
+        default:                 return run_typed<float>(ocl, opt, config, size, out, start);
+    }
+}
+
+// Runs a configuration on every device at the same time, one host thread per
+// device, then prints their reports one after the other. Each thread reports to
+// a stream of its own, and all of them start timing once every setup is done.
+vector<Results> run_devices(vector<OCL> & ocls, const vector<int> & ids,
+                            const Options & opt, const Config & config, size_t size)
+{
+    vector<ostringstream> reports(ocls.size());
+    vector<Results> results(ocls.size(), Results(opt.iterations, size));
+    Barrier start(ocls.size());
+    vector<thread> threads;
+    for (size_t d = 0; d < ocls.size(); ++d) {
+        threads.emplace_back([&, d]() {
+            results[d] = run(ocls[d], opt, config, size, reports[d], &start);
+        });
+    }
+    for (auto & t : threads) t.join();
+
+    for (size_t d = 0; d < ocls.size(); ++d) cout << "Device " << ids[d] << ": " << reports[d].str();
+    print_devices(config.name(), ids, results);
+    return results;
+}
 
 int main(int argc, char * argv[])
 {
     Options opt;
     opt.process_args(argc, argv);
 
-    OCL ocl;
-    ocl.init(opt.aocx_filename, opt.platform, opt.device);
+    // The CPU reference runs without a board: the device is only opened when
+    // some other benchmark needs it
+    auto configs = configurations(opt);
+    bool device_needed = opt.launch or opt.persistent or opt.duplex or opt.dataset > 0;
+    for (const auto & config : configs) device_needed |= (config.kernel_type != clKernelType::CPU);
+
+    // One context and program per device. With --devices the configurations
+    // run on all of them at once, each driven by its own host thread.
+    vector<int> device_ids(1, opt.device);
+    if (opt.multi_device) {
+        device_ids = opt.devices;
+        if (device_ids.empty()) {
+            const auto platform = clSelectPlatform(opt.platform);
+            const int n_devices = clGetDevices(platform, CL_DEVICE_TYPE_ALL).size();
+            for (int d = 0; d < n_devices; ++d) device_ids.push_back(d);
+        }
+    }
+    const size_t n_devices = device_ids.size();
+    vector<OCL> ocls(n_devices);
+    if (device_needed) {
+        for (size_t d = 0; d < n_devices; ++d) ocls[d].init(opt.aocx_filename, opt.platform, device_ids[d]);
+    }
 
-    double mem_batch = opt.size * sizeof(float) / (double)(1 << 20);
-    double mem_total = 2 * opt.iterations * mem_batch;
-    cout << fixed << setprecision(3)
-         << "   Iterations: " << opt.iterations            << "\n"
-         << "  Batch Items: " << opt.size                  << " items\n"
-         << " Batch Memory: " << mem_batch                 << " MB\n"
-         << "  Total Items: " << opt.iterations * opt.size << " items\n"
-         << " Total Memory: " << mem_total                 << " MB\n"
-         << "\n";
+    // Variants left out of the bitstream fail here rather than halfway through
+    if (device_needed and opt.banks > 0 and !ocls[0].hasKernel(K_READER_BANK_NAME + to_string(opt.banks - 1))) {
+        cerr << "The program has fewer than " << opt.banks << " bank pipelines, rebuild it with N_BANKS="
+             << opt.banks << endl;
+        exit(1);
+    }
+    const bool typed = any_of(configs.begin(), configs.end(),
+                              [](const Config & c) { return c.data_type != clDataType::Float; });
+    if (device_needed and typed and !ocls[0].hasKernel(K_COMPUTE_SINGLE_NAME + string(DataType<int32_t>::suffix()))) {
+        cerr << "The program has no element type kernels, rebuild it with TYPE_KERNELS=1" << endl;
+        exit(1);
+    }
+    if (device_needed and !opt.autorun_units.empty()) {
+        vector<int> built;
+        for (int units : opt.autorun_units) {
+            if (ocls[0].hasKernel(K_READER_AUTORUN_NAME K_CU_SUFFIX + to_string(units))) {
+                built.push_back(units);
+            } else if (!opt.autorun_all_units) {
+                cerr << "The program has no Autorun kernels of " << units
+                     << " compute units, rebuild it with AUTORUN_CU_MAX=" << units << endl;
+                exit(1);
+            }
+        }
+        // `all` stands for the unit counts up to AUTORUN_CU_MAX of the build
+        opt.autorun_units = built;
+        configs = configurations(opt);
+    }
+    if (device_needed and !opt.simd_variants.empty()) {
+        vector<SimdVariant> built;
+        for (const auto & variant : opt.simd_variants) {
+            if (ocls[0].hasKernel(variant.kernel_name())) {
+                built.push_back(variant);
+            } else if (!opt.simd_all) {
+                cerr << "The program has no " << variant.kernel_name() << " kernel, rebuild it with SIMD_KERNELS=1"
+                     << (variant.cus > 1 ? " and SIMD_CU_MAX=" + to_string(variant.cus) : "") << endl;
+                exit(1);
+            }
+        }
+        if (built.empty()) {
+            cerr << "The program has no fused NDRange kernels, rebuild it with SIMD_KERNELS=1" << endl;
+            exit(1);
+        }
+        // `all` stands for the variants up to SIMD_CU_MAX of the build
+        opt.simd_variants = built;
+        configs = configurations(opt);
+    }
 
+    // Prefix of the benchmarks that are run on one device after the other
+    auto device_label = [&](size_t d) {
+        if (opt.multi_device) cout << "Device " << device_ids[d] << ": ";
+    };
+
+    // One arena holds the clMemBuffer slots of the largest configuration, plus
+    // the gather index and room to align every sub-buffer. Buffers placed in
+    // a bank cannot be sub-buffers and get their own allocation instead.
+    const auto sizes = opt.sizes();
+    const size_t max_size = sizes.empty() ? 0 : *max_element(sizes.begin(), sizes.end());
+    size_t arena_bytes = 0;
+    for (const auto & config : configs) {
+        if (config.mem_type != clMemoryType::Buffer or opt.src_bank != 0 or opt.dst_bank != 0 or
+            config.kernel_type == clKernelType::MultiBank or config.kernel_type == clKernelType::CPU) continue;
+        const size_t bytes = 2 * opt.inflight * max_size * data_type_size(config.data_type)
+                           + max_size * sizeof(int);
+        arena_bytes = max(arena_bytes, bytes);
+    }
+    if (device_needed and arena_bytes > 0) {
+        for (auto & ocl : ocls) ocl.reserveArena(arena_bytes, 2 * opt.inflight + 1);
+    }
 
-    if (opt.task) {
-        if (opt.buffer) benchmark(ocl, opt.iterations, opt.size,
-                                  clKernelType::Task, clMemoryType::Buffer,
-                                  opt.check_results);
-        if (opt.shared) benchmark(ocl, opt.iterations, opt.size,
-                                  clKernelType::Task, clMemoryType::Shared,
-                                  opt.check_results);
+    if (opt.launch) {
+        for (size_t d = 0; d < n_devices; ++d) {
+            device_label(d);
+            benchmark_launch(ocls[d], opt.iterations, opt.warmup, false);
+            device_label(d);
+            benchmark_launch(ocls[d], opt.iterations, opt.warmup, true);
+        }
     }
 
-    if (opt.range) {
-        if (opt.buffer) benchmark(ocl, opt.iterations, opt.size,
-                                  clKernelType::NDRange, clMemoryType::Buffer,
-                                  opt.check_results);
-        if (opt.shared) benchmark(ocl, opt.iterations, opt.size,
-                                  clKernelType::NDRange, clMemoryType::Shared,
-                                  opt.check_results);
+    // The context and program are shared by every size of the sweep. Curves
+    // are kept per configuration and device.
+    vector<vector<Results>> curves(configs.size() * n_devices);
+    auto curve_name = [&](size_t c, size_t d) {
+        return configs[c].name() + (opt.multi_device ? " / device " + to_string(device_ids[d]) : "");
+    };
+    size_t stream_mismatches = 0;
+    for (size_t size : sizes) {
+        double mem_batch = size * opt.item_bytes() / (double)(1 << 20);
+        double mem_total = 2 * opt.iterations * mem_batch;
+        cout << fixed << setprecision(3)
+             << "   Iterations: " << opt.iterations                << "\n"
+             << "       Warmup: " << opt.warmup                    << " iterations\n"
+             << "  Batch Items: " << size                          << " items\n"
+             << "     Inflight: " << opt.inflight                  << " iterations\n"
+             << "  Sync Window: " << (opt.window > 0 ? to_string(opt.window) + " iterations" : "sliding") << "\n"
+             << "       Queues: " << (opt.out_of_order ? "out-of-order" : "in-order") << "\n"
+             << "         Pool: " << opt.pool                      << " datasets\n"
+             << " Batch Memory: " << mem_batch                     << " MB\n"
+             << "  Total Items: " << size_t(opt.iterations) * size << " items\n"
+             << " Total Memory: " << mem_total                     << " MB\n"
+             << "\n";
+
+        for (size_t c = 0; c < configs.size(); ++c) {
+            if (opt.multi_device) {
+                const auto results = run_devices(ocls, device_ids, opt, configs[c], size);
+                for (size_t d = 0; d < n_devices; ++d) curves[c * n_devices + d].push_back(results[d]);
+            } else {
+                curves[c].push_back(run(ocls[0], opt, configs[c], size));
+            }
+        }
+
+        // Roofline of the configurations whose compute stage has a tunable intensity
+        if (opt.fmas.size() > 1 or opt.fmas[0] > 0) {
+            vector<string> names;
+            vector<Results> points;
+            for (size_t c = 0; c < configs.size(); ++c) {
+                if (configs[c].kernel_type != clKernelType::Task and
+                    configs[c].kernel_type != clKernelType::NDRange) continue;
+                if (configs[c].pattern.type != clAccessPattern::Sequential) continue;
+                for (size_t d = 0; d < n_devices; ++d) {
+                    names.push_back(curve_name(c, d));
+                    points.push_back(curves[c * n_devices + d].back());
+                }
+            }
+            print_roofline(names, points);
+        }
+
+        // Scaling of the Autorun kernels, per memory type and device, against
+        // the fewest units, first in the sorted list
+        if (opt.autorun_units.size() > 1) {
+            for (size_t c = 0; c < configs.size(); ++c) {
+                if (configs[c].units == 0 or configs[c].units != opt.autorun_units[0]) continue;
+                for (size_t d = 0; d < n_devices; ++d) {
+                    vector<int> units;
+                    vector<Results> points;
+                    for (size_t u = c; u < configs.size(); ++u) {
+                        if (configs[u].units == 0 or configs[u].mem_type != configs[c].mem_type) continue;
+                        units.push_back(configs[u].units);
+                        points.push_back(curves[u * n_devices + d].back());
+                    }
+                    print_scaling(string("Autorun / ") + mem_type_name(configs[c].mem_type)
+                                  + (opt.multi_device ? " / device " + to_string(device_ids[d]) : ""),
+                                  units, points);
+                }
+            }
+        }
+
+        // Fused NDRange variants against the scalar single-task pipeline, per
+        // memory type and device, from the first kernel start to the last end
+        if (!opt.simd_variants.empty()) {
+            for (size_t f = 0; f < configs.size(); ++f) {
+                const auto & first = opt.simd_variants[0];
+                if (configs[f].fused.wg != first.wg or configs[f].fused.simd != first.simd or
+                    configs[f].fused.cus != first.cus) continue;
+                const clMemoryType mem_type = configs[f].mem_type;
+                for (size_t d = 0; d < n_devices; ++d) {
+                    vector<string> names;
+                    vector<Results> points;
+                    for (size_t c = 0; c < configs.size(); ++c) {
+                        const auto & config = configs[c];
+                        if (config.mem_type != mem_type) continue;
+                        if (config.pattern.type != clAccessPattern::Sequential) continue;
+                        const bool task = (config.kernel_type == clKernelType::Task and config.vec == 1 and
+                                           config.fma == 0 and config.data_type == clDataType::Float);
+                        if (!task and config.fused.wg == 0) continue;
+                        // The single-task pipeline leads as the baseline
+                        names.insert(task ? names.begin() : names.end(), curve_name(c, d));
+                        points.insert(task ? points.begin() : points.end(), curves[c * n_devices + d].back());
+                    }
+                    print_styles(string(mem_type_name(mem_type))
+                                 + (opt.multi_device ? " / device " + to_string(device_ids[d]) : ""),
+                                 names, points);
+                }
+            }
+        }
+
+        // Every iteration is a chunk of the stream, as many as in flight
+        if (opt.persistent) {
+            for (size_t d = 0; d < n_devices; ++d) {
+                device_label(d);
+                const auto stream = benchmark_persistent(ocls[d], opt.iterations, opt.warmup, size,
+                                                         opt.inflight, opt.pool,
+                                                         opt.check_results, opt.max_ulps);
+                stream_mismatches += stream.check.mismatches;
+            }
+        }
+
+        if (opt.duplex) {
+            for (size_t d = 0; d < n_devices; ++d) {
+                device_label(d);
+                benchmark_duplex(ocls[d], opt.iterations, opt.warmup, size);
+            }
+        }
+
+        // The batch is the chunk of the dataset, at least three of them in flight
+        if (opt.dataset > 0) {
+            for (size_t d = 0; d < n_devices; ++d) {
+                device_label(d);
+                const auto chunked = benchmark_chunked(ocls[d], opt.iterations, opt.warmup,
+                                                       opt.dataset / sizeof(float), size,
+                                                       max(3, opt.inflight), opt.input, opt.output,
+                                                       opt.check_results, opt.max_ulps);
+                stream_mismatches += chunked.check.mismatches;
+            }
+        }
     }
 
-    if (opt.autorun) {
-        if (opt.buffer) benchmark_autorun(ocl, opt.iterations, opt.size,
-                                          clMemoryType::Buffer,
-                                          opt.check_results);
-        if (opt.shared) benchmark_autorun(ocl, opt.iterations, opt.size,
-                                          clMemoryType::Shared,
-                                          opt.check_results);
+    if (opt.sweep) {
+        for (size_t c = 0; c < configs.size(); ++c) {
+            for (size_t d = 0; d < n_devices; ++d) print_sweep(curve_name(c, d), curves[c * n_devices + d]);
+        }
     }
 
-    ocl.clean();
+    for (auto & ocl : ocls) ocl.clean();
+
+    if (stream_mismatches > 0) return -2;
+    for (const auto & curve : curves) {
+        for (const auto & results : curve) {
+            if (results.check.mismatches > 0) return -2;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}